@@ -157,6 +157,48 @@ static void bench_count_lines(benchmark::State& state) {
 
 BENCHMARK(bench_count_lines)->Name("op:count_lines/impl:count_lines/lang:C++")->UseRealTime();
 
+/**
+ * Benchmark counting lines using the portable fmm::count_lines_scalar, i.e. count_lines without SIMD.
+ */
+static void bench_count_lines_scalar(benchmark::State& state) {
+    const std::string large = construct_large_coord_string(kCoordTargetBytes);
+
+    std::size_t num_bytes = 0;
+
+    for ([[maybe_unused]] auto _ : state) {
+        auto [lines, empties] = fast_matrix_market::count_lines_scalar(large);
+        benchmark::DoNotOptimize(lines);
+        benchmark::DoNotOptimize(empties);
+        num_bytes += large.size();
+    }
+
+    state.SetBytesProcessed((int64_t)num_bytes);
+}
+
+BENCHMARK(bench_count_lines_scalar)->Name("op:count_lines/impl:count_lines_scalar/lang:C++")->UseRealTime();
+
+#ifdef FMM_SIMD_SSE2
+/**
+ * Benchmark counting lines using the SSE2 kernel, i.e. what count_lines uses if AVX2 is not available.
+ */
+static void bench_count_lines_sse2(benchmark::State& state) {
+    const std::string large = construct_large_coord_string(kCoordTargetBytes);
+
+    std::size_t num_bytes = 0;
+
+    for ([[maybe_unused]] auto _ : state) {
+        auto [lines, empties] = fast_matrix_market::simd::count_lines_sse2(large);
+        benchmark::DoNotOptimize(lines);
+        benchmark::DoNotOptimize(empties);
+        num_bytes += large.size();
+    }
+
+    state.SetBytesProcessed((int64_t)num_bytes);
+}
+
+BENCHMARK(bench_count_lines_sse2)->Name("op:count_lines/impl:count_lines_sse2/lang:C++")->UseRealTime();
+#endif
+
 /**
  * Benchmark counting empty lines using std::count
  */
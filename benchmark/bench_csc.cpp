@@ -41,3 +41,37 @@ static void csc_write(benchmark::State& state) {
 }
 
 BENCHMARK(csc_write)->Name("op:write/matrix:CSC/impl:FMM/lang:C++")->UseRealTime()->Iterations(num_iterations)->Apply(NumThreadsArgument);
+
+/**
+ * Read CSC directly, without intermediate triplets.
+ */
+static void csc_read(benchmark::State& state) {
+    static const std::string csc_string_to_read = [] {
+        std::ostringstream oss;
+        fast_matrix_market::write_matrix_market_csc(oss,
+                                                    {csc_to_write.nrows, csc_to_write.ncols},
+                                                    csc_to_write.indptr, csc_to_write.indices, csc_to_write.vals,
+                                                    false);
+        return oss.str();
+    }();
+
+    fast_matrix_market::read_options options;
+    options.parallel_ok = true;
+    options.num_threads = (int)state.range(0);
+
+    std::size_t num_bytes = 0;
+
+    for ([[maybe_unused]] auto _ : state) {
+        fast_matrix_market::matrix_market_header header;
+        csc_matrix<int64_t, VT> csc;
+
+        std::istringstream iss(csc_string_to_read);
+        fast_matrix_market::read_matrix_market_csc(iss, header, csc.indptr, csc.indices, csc.vals, options);
+        num_bytes += csc_string_to_read.size();
+        benchmark::ClobberMemory();
+    }
+
+    state.SetBytesProcessed((int64_t)num_bytes);
+}
+
+BENCHMARK(csc_read)->Name("op:read/matrix:CSC/impl:FMM/lang:C++")->UseRealTime()->Iterations(num_iterations)->Apply(NumThreadsArgument);
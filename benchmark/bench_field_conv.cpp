@@ -0,0 +1,86 @@
+// Copyright (C) 2023 Adam Lugowski. All rights reserved.
+// Use of this source code is governed by the BSD 2-clause license found in the LICENSE.txt file.
+// SPDX-License-Identifier: BSD-2-Clause
+
+#include <random>
+
+#include "fmm_bench.hpp"
+
+/**
+ * Construct a string of coordinate-like integers separated by spaces and newlines.
+ */
+static std::string construct_int_string(std::size_t byte_target) {
+    std::mt19937 gen(0);
+    std::uniform_int_distribution<int64_t> dist(1, 10'000'000);
+
+    std::string ret;
+    ret.reserve(byte_target + 32);
+    while (ret.size() < byte_target) {
+        ret += std::to_string(dist(gen));
+        ret += ' ';
+        ret += std::to_string(dist(gen));
+        ret += '\n';
+    }
+    return ret;
+}
+
+static const std::string int_string = construct_int_string(kCoordTargetBytes / 4);
+
+/**
+ * Benchmark reading integers with a read_int-like function.
+ */
+template <typename READ_INT>
+static void read_ints(benchmark::State& state, READ_INT read_int) {
+    std::size_t num_bytes = 0;
+
+    for ([[maybe_unused]] auto _ : state) {
+        const char* pos = int_string.c_str();
+        const char* end = pos + int_string.size();
+        int64_t sum = 0;
+        while (pos != end) {
+            int64_t value;
+            pos = read_int(pos, end, value);
+            sum += value;
+            ++pos; // skip the separator
+        }
+        benchmark::DoNotOptimize(sum);
+        num_bytes += int_string.size();
+    }
+
+    state.SetBytesProcessed((int64_t)num_bytes);
+}
+
+/**
+ * Benchmark fmm::read_int, i.e. the best available method.
+ */
+static void read_int(benchmark::State& state) {
+    read_ints(state, [](const char* pos, const char* end, int64_t& out) {
+        return fast_matrix_market::read_int(pos, end, out);
+    });
+}
+
+BENCHMARK(read_int)->Name("op:read_int/impl:read_int/lang:C++");
+
+#ifdef FMM_FROM_CHARS_INT_SUPPORTED
+/**
+ * Benchmark std::from_chars.
+ */
+static void read_int_from_chars(benchmark::State& state) {
+    read_ints(state, [](const char* pos, const char* end, int64_t& out) {
+        return fast_matrix_market::read_int_from_chars(pos, end, out);
+    });
+}
+
+BENCHMARK(read_int_from_chars)->Name("op:read_int/impl:from_chars/lang:C++");
+#endif
+
+/**
+ * Benchmark strtoll.
+ */
+static void read_int_fallback(benchmark::State& state) {
+    read_ints(state, [](const char* pos, const char* end, int64_t& out) {
+        return fast_matrix_market::read_int_fallback(pos, end, out);
+    });
+}
+
+BENCHMARK(read_int_fallback)->Name("op:read_int/impl:fallback/lang:C++");
@@ -0,0 +1,61 @@
+// Copyright (C) 2023 Adam Lugowski. All rights reserved.
+// Use of this source code is governed by the BSD 2-clause license found in the LICENSE.txt file.
+// SPDX-License-Identifier: BSD-2-Clause
+
+#include <algorithm>
+#include <sstream>
+
+#include "fmm_bench.hpp"
+
+static int num_iterations = 3;
+
+/**
+ * Thread counts to compare: 2, then powers of two up to the number of cores.
+ */
+static std::vector<int64_t> thread_counts() {
+    std::vector<int64_t> ret;
+    int64_t max_threads = std::max(2u, std::thread::hardware_concurrency());
+    for (int64_t p = 2; p < max_threads; p *= 2) {
+        ret.push_back(p);
+    }
+    ret.push_back(max_threads);
+    return ret;
+}
+
+static std::string construct_pool_bench_string() {
+    std::string body = construct_large_coord_string(kCoordTargetBytes / 8);
+    auto nnz = std::count(body.begin(), body.end(), '\n');
+    return "%%MatrixMarket matrix coordinate real general\n234567 234567 " + std::to_string(nnz) + "\n" + body;
+}
+
+static std::string pool_bench_string = construct_pool_bench_string();
+
+/**
+ * Parallel coordinate read with each thread pool implementation.
+ *
+ * Small chunks mean many short tasks, which is where a single task queue lock becomes contended.
+ */
+static void read_thread_pool(benchmark::State& state) {
+    fast_matrix_market::read_options options{};
+    options.pool_type = state.range(0) == 0 ? fast_matrix_market::FifoPool : fast_matrix_market::WorkStealingPool;
+    options.chunk_size_bytes = state.range(1);
+    options.num_threads = (int)state.range(2);
+
+    std::size_t num_bytes = 0;
+
+    for ([[maybe_unused]] auto _ : state) {
+        fast_matrix_market::matrix_market_header header;
+        triplet_matrix<int64_t, double> triplet;
+
+        std::istringstream iss(pool_bench_string);
+        fast_matrix_market::read_matrix_market_triplet(iss, header, triplet.rows, triplet.cols, triplet.vals, options);
+        num_bytes += pool_bench_string.size();
+        benchmark::ClobberMemory();
+    }
+
+    state.SetBytesProcessed((int64_t)num_bytes);
+}
+
+BENCHMARK(read_thread_pool)->Name("op:read/matrix:Coordinate/impl:FMM/lang:C++/pool")->UseRealTime()->Iterations(num_iterations)
+    ->ArgNames({"work_stealing", "chunk_size", "p"})
+    ->ArgsProduct({{0, 1}, {8 << 10, 64 << 10, 1 << 20}, thread_counts()});
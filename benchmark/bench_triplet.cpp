@@ -2,7 +2,10 @@
 // Use of this source code is governed by the BSD 2-clause license found in the LICENSE.txt file.
 // SPDX-License-Identifier: BSD-2-Clause
 
+#include <algorithm>
+#include <filesystem>
 #include <sstream>
+#include <thread>
 
 #include "fmm_bench.hpp"
 
@@ -54,6 +57,94 @@ static void triplet_read(benchmark::State& state) {
 
 BENCHMARK(triplet_read)->Name("op:read/matrix:Coordinate/impl:FMM/lang:C++")->UseRealTime()->Iterations(num_iterations)->Apply(NumThreadsArgument);
 
+/**
+ * Read triplets with fused count and parse.
+ */
+static void triplet_read_fused(benchmark::State& state) {
+    // read options
+    fast_matrix_market::read_options options{};
+    options.parallel_ok = true;
+    options.num_threads = (int)state.range(0);
+    options.fused_count_parse = true;
+
+    std::size_t num_bytes = 0;
+
+    for ([[maybe_unused]] auto _ : state) {
+        fast_matrix_market::matrix_market_header header;
+        triplet_matrix<int64_t, VT> triplet;
+
+        std::istringstream iss(triplet_string_to_read);
+        fast_matrix_market::read_matrix_market_triplet(iss, header, triplet.rows, triplet.cols, triplet.vals, options);
+        num_bytes += triplet_string_to_read.size();
+        benchmark::ClobberMemory();
+    }
+
+    state.SetBytesProcessed((int64_t)num_bytes);
+}
+
+BENCHMARK(triplet_read_fused)->Name("op:read/matrix:Coordinate/impl:FMM/lang:C++/mode:fused")->UseRealTime()->Iterations(num_iterations)->Apply(NumThreadsArgument);
+
+/**
+ * Read triplets from memory without chunk copies, as when reading a memory-mapped file.
+ */
+static void triplet_read_memory(benchmark::State& state) {
+    // read options
+    fast_matrix_market::read_options options{};
+    options.parallel_ok = true;
+    options.num_threads = (int)state.range(0);
+
+    std::size_t num_bytes = 0;
+
+    for ([[maybe_unused]] auto _ : state) {
+        fast_matrix_market::matrix_market_header header;
+        triplet_matrix<int64_t, VT> triplet;
+
+        fast_matrix_market::memory_streambuf membuf(triplet_string_to_read.data(),
+                                                    triplet_string_to_read.data() + triplet_string_to_read.size());
+        std::istream instream(&membuf);
+        fast_matrix_market::read_matrix_market_triplet(instream, header, triplet.rows, triplet.cols, triplet.vals, options);
+        num_bytes += triplet_string_to_read.size();
+        benchmark::ClobberMemory();
+    }
+
+    state.SetBytesProcessed((int64_t)num_bytes);
+}
+
+BENCHMARK(triplet_read_memory)->Name("op:read/matrix:Coordinate/impl:FMM/lang:C++/source:memory")->UseRealTime()->Iterations(num_iterations)->Apply(NumThreadsArgument);
+
+
+std::string small_triplet_string_to_read = generate_read_string(construct_triplet<int64_t, VT>(256 << 10));
+
+/**
+ * Read many small triplet matrices.
+ *
+ * Argument 0 uses the shared default thread pool. Argument 1 creates a new pool for every call.
+ */
+static void triplet_read_small(benchmark::State& state) {
+    fast_matrix_market::read_options options{};
+    options.parallel_ok = true;
+    options.chunk_size_bytes = 16 << 10;
+    if (state.range(0) == 1) {
+        // At least 2, as 1 thread selects the sequential reader.
+        options.num_threads = std::max(2, (int)std::thread::hardware_concurrency());
+    }
+
+    std::size_t num_bytes = 0;
+
+    for ([[maybe_unused]] auto _ : state) {
+        fast_matrix_market::matrix_market_header header;
+        triplet_matrix<int64_t, VT> triplet;
+
+        std::istringstream iss(small_triplet_string_to_read);
+        fast_matrix_market::read_matrix_market_triplet(iss, header, triplet.rows, triplet.cols, triplet.vals, options);
+        num_bytes += small_triplet_string_to_read.size();
+        benchmark::ClobberMemory();
+    }
+
+    state.SetBytesProcessed((int64_t)num_bytes);
+}
+
+BENCHMARK(triplet_read_small)->Name("op:read/matrix:Coordinate/impl:FMM/lang:C++/size:small/pool_per_call")->UseRealTime()->Arg(0)->Arg(1);
 
 /**
  * Write triplets.
@@ -84,3 +175,30 @@ static void triplet_write(benchmark::State& state) {
 }
 
 BENCHMARK(triplet_write)->Name("op:write/matrix:Coordinate/impl:FMM/lang:C++")->UseRealTime()->Iterations(num_iterations)->Apply(NumThreadsArgument);
+
+/**
+ * Write triplets to a file. Chunks are written concurrently with pwrite().
+ */
+static void triplet_write_file(benchmark::State& state) {
+    const std::string path = (std::filesystem::temp_directory_path() / "fmm_bench_triplet_write.mtx").string();
+    std::size_t num_bytes = 0;
+
+    fast_matrix_market::write_options options;
+    options.parallel_ok = true;
+    options.num_threads = (int)state.range(0);
+
+    for ([[maybe_unused]] auto _ : state) {
+        fast_matrix_market::write_matrix_market_triplet(path,
+                                                        {triplet_to_write.nrows, triplet_to_write.ncols},
+                                                        triplet_to_write.rows, triplet_to_write.cols, triplet_to_write.vals,
+                                                        options);
+
+        num_bytes += std::filesystem::file_size(path);
+        benchmark::ClobberMemory();
+    }
+
+    std::filesystem::remove(path);
+    state.SetBytesProcessed((int64_t)num_bytes);
+}
+
+BENCHMARK(triplet_write_file)->Name("op:write/matrix:Coordinate/impl:FMM/lang:C++/target:file")->UseRealTime()->Iterations(num_iterations)->Apply(NumThreadsArgument);
@@ -0,0 +1,32 @@
+// Copyright (C) 2023 Adam Lugowski. All rights reserved.
+// Use of this source code is governed by the BSD 2-clause license found in the LICENSE.txt file.
+// SPDX-License-Identifier: BSD-2-Clause
+
+#include <iostream>
+#include <string>
+#include <fast_matrix_market/fast_matrix_market.hpp>
+
+namespace fmm = fast_matrix_market;
+
+int main(int argc, char **argv) {
+    if (argc < 2) {
+        std::cout << "Build a line index of a coordinate .mtx file for random access to its elements." << std::endl;
+        std::cout << std::endl;
+        std::cout << "Usage:" << std::endl;
+        std::cout << argv[0] << " <file>.mtx [stride]" << std::endl;
+        std::cout << std::endl;
+        std::cout << "will create a file named '<file>.mtx.fmmindex' that records the position of every" << std::endl;
+        std::cout << "stride-th element (default 65536). Pass it to read_line_index() and" << std::endl;
+        std::cout << "read_matrix_market_triplet_range()." << std::endl;
+        return 0;
+    }
+
+    std::string path{argv[1]};
+    int64_t stride = argc > 2 ? std::stoll(argv[2]) : 65536;
+
+    fmm::line_index index = fmm::build_line_index(path, stride);
+    fmm::write_line_index(fmm::line_index_path(path), index);
+
+    std::cout << "Indexed " << index.num_elements << " elements with " << index.entries.size() << " entries." << std::endl;
+    return 0;
+}
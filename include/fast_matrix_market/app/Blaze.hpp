@@ -27,67 +27,33 @@ namespace fast_matrix_market {
         mat.clear();
         mat.resize(header.nrows, header.ncols);
 
-        // Read into triplets
-        std::vector<IT> rows;
-        std::vector<IT> cols;
-        std::vector<VT> vals;
-
-        read_matrix_market_body_triplet(instream, header, rows, cols, vals, default_pattern_value, options);
-
-        size_t storage_nnz = vals.size();
-        mat.reserve(storage_nnz);
-
-        // Set the values into the matrix from the triplets.
         // The matrix needs to be constructed row-by-row (if row-major) or column-by-column (if col-major), in order.
-        // So first sort the triplets in the appropriate order (or rather, find a sort permutation),
-        // then step through the major dimension and insert values.
-
+        // Read directly into that order with a parallel counting sort on the major index.
         bool is_row_major = blaze::IsRowMajorMatrix_v<SparseMatrix>;
-        const std::vector<IT>* major;
 
-        // Find sort permutation
-        std::vector<std::size_t> perm(storage_nnz);
-        std::iota(perm.begin(), perm.end(), 0);
-        if (is_row_major) {
-            major = &rows;
-            std::sort(perm.begin(), perm.end(),
-                      [&](std::size_t i, std::size_t j) {
-                          if (rows[i] != rows[j])
-                              return rows[i] < rows[j];
-                          if (cols[i] != cols[j])
-                              return cols[i] < cols[j];
-
-                          return false;
-                      });
-        } else {
-            major = &cols;
-            std::sort(perm.begin(), perm.end(),
-                      [&](std::size_t i, std::size_t j) {
-                          if (cols[i] != cols[j])
-                              return cols[i] < cols[j];
-                          if (rows[i] != rows[j])
-                              return rows[i] < rows[j];
-
-                          return false;
-                      });
-        }
+        std::vector<IT> indptr;
+        std::vector<IT> indices;
+        std::vector<VT> vals;
+
+        read_matrix_market_body_compressed(instream, header, indptr, indices, vals, !is_row_major, default_pattern_value, options);
+
+        app_stage_timer timer(options, stage_convert);
+        mat.reserve(vals.size());
 
         // Construct the matrix.
         IT major_end = is_row_major ? header.nrows : header.ncols;
-        auto perm_iter = perm.cbegin();
 
         for (IT major_i = 0; major_i < major_end; ++major_i) {
-            while (perm_iter != perm.cend() && (*major)[*perm_iter] == major_i) {
-                mat.append(rows[*perm_iter], cols[*perm_iter], vals[*perm_iter]);
-                ++perm_iter;
+            for (IT i = indptr[major_i]; i < indptr[major_i + 1]; ++i) {
+                if (is_row_major) {
+                    mat.append(major_i, indices[i], vals[i]);
+                } else {
+                    mat.append(indices[i], major_i, vals[i]);
+                }
             }
 
             mat.finalize(major_i);
         }
-
-        if (perm_iter != perm.cend()) {
-            throw fmm_error("Did not use all the values that were read!");
-        }
     }
 
     /**
@@ -145,8 +111,7 @@ namespace fast_matrix_market {
                     line_formatter(lf), mat(mat), major_iter(major_iter), major_end(major_end) {}
 
             std::string operator()() {
-                std::string chunk;
-                chunk.reserve((major_end - major_iter)*250);
+                chunk_output chunk((major_end - major_iter)*250);
 
                 const bool is_row_major = blaze::IsRowMajorMatrix_v<SparseMatrixType>;
 
@@ -156,14 +121,14 @@ namespace fast_matrix_market {
                         auto minor_idx = it->index();
 
                         if (is_row_major) {
-                            chunk += line_formatter.coord_matrix(major_iter, minor_idx, it->value());
+                            line_formatter.coord_matrix(chunk, major_iter, minor_idx, it->value());
                         } else {
-                            chunk += line_formatter.coord_matrix(minor_idx, major_iter, it->value());
+                            line_formatter.coord_matrix(chunk, minor_idx, major_iter, it->value());
                         }
                     }
                 }
 
-                return chunk;
+                return chunk.release();
             }
 
             LF line_formatter;
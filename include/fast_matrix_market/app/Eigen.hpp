@@ -16,38 +16,72 @@
 
 
 namespace fast_matrix_market {
+    /**
+     * Exposes one of the compressed arrays of an Eigen sparse matrix as a vector, so it can be read into directly.
+     *
+     * The outer index array is sized by the matrix dimensions. The inner index and value arrays are resized together.
+     */
+    template <typename SparseType, typename T>
+    class eigen_compressed_vector {
+    public:
+        using value_type = T;
+        using data_getter = T* (*)(SparseType&);
+
+        eigen_compressed_vector(SparseType& mat, data_getter get_data, bool is_outer) :
+                mat(mat), get_data(get_data), is_outer(is_outer) {}
+
+        void resize(std::size_t n) {
+            if (!is_outer) {
+                mat.resizeNonZeros((typename SparseType::Index)n);
+            }
+        }
+
+        [[nodiscard]] std::size_t size() const {
+            return (std::size_t)(is_outer ? mat.outerSize() + 1 : mat.data().size());
+        }
+
+        T* begin() const { return get_data(mat); }
+        T* end() const { return begin() + size(); }
+        T& operator[](std::size_t i) const { return begin()[i]; }
+
+    protected:
+        SparseType& mat;
+        data_getter get_data;
+        bool is_outer;
+    };
+
     /**
      * Read Matrix Market file into an Eigen matrix and a header struct.
+     *
+     * The body is read directly into the matrix's compressed arrays with a parallel count and scatter, with no
+     * intermediate triplets. Duplicate elements are summed, as with setFromTriplets().
      */
     template <typename SparseType>
     void read_matrix_market_eigen(std::istream &instream,
                                   matrix_market_header &header,
                                   SparseType& mat,
-                                  read_options options = {},
+                                  const read_options& options = {},
                                   typename SparseType::Scalar default_pattern_value = 1) {
 
         typedef typename SparseType::Scalar Scalar;
         typedef typename SparseType::StorageIndex StorageIndex;
-        typedef Eigen::Triplet<Scalar, StorageIndex> Triplet;
 
         read_header(instream, header);
         mat.resize(header.nrows, header.ncols);
 
-        // Sanitize symmetry generalization settings
-        if (options.generalize_symmetry && options.generalize_symmetry_app) {
-            // setFromTriplets() drops zero elements
-            options.generalize_coordinate_diagnonal_values = read_options::ExtraZeroElement;
-        }
-
-        // read into tuples
-        std::vector<Triplet> elements;
-        elements.resize(get_storage_nnz(header, options));
+        auto indptr = eigen_compressed_vector<SparseType, StorageIndex>(
+                mat, [](SparseType& m) { return m.outerIndexPtr(); }, true);
+        auto indices = eigen_compressed_vector<SparseType, StorageIndex>(
+                mat, [](SparseType& m) { return m.innerIndexPtr(); }, false);
+        auto values = eigen_compressed_vector<SparseType, Scalar>(
+                mat, [](SparseType& m) { return m.valuePtr(); }, false);
 
-        auto handler = tuple_parse_handler<StorageIndex, Scalar, decltype(elements.begin())>(elements.begin());
-        read_matrix_market_body(instream, header, handler, default_pattern_value, options);
+        read_matrix_market_body_compressed(instream, header, indptr, indices, values, !SparseType::IsRowMajor,
+                                           default_pattern_value, options);
 
-        // set the values into the matrix
-        mat.setFromTriplets(elements.begin(), elements.end());
+        app_stage_timer timer(options, stage_convert);
+        auto nnz = sum_duplicates_compressed(indptr, indices, values);
+        mat.resizeNonZeros((typename SparseType::Index)nnz);
     }
 
     /**
@@ -111,17 +145,16 @@ namespace fast_matrix_market {
             line_formatter(lf), mat(mat), outer_iter(outer_iter), outer_end(outer_end) {}
 
             std::string operator()() {
-                std::string chunk;
-                chunk.reserve((outer_end - outer_iter)*250);
+                chunk_output chunk((outer_end - outer_iter)*250);
 
                 // iterate over assigned columns
                 for (; outer_iter != outer_end; ++outer_iter) {
                     for (typename SparseMatrixType::InnerIterator it(mat, outer_iter); it; ++it) {
-                        chunk += line_formatter.coord_matrix(it.row(), it.col(), it.value());
+                        line_formatter.coord_matrix(chunk, it.row(), it.col(), it.value());
                     }
                 }
 
-                return chunk;
+                return chunk.release();
             }
 
             LF line_formatter;
@@ -4,6 +4,8 @@
 
 #pragma once
 
+// for realloc, free
+#include <cstdlib>
 // for std::iota
 #include <numeric>
 
@@ -547,10 +549,10 @@ namespace fast_matrix_market {
      * Read a Matrix Market coordinate body into a sparse GraphBLAS matrix using triplets.
      */
     template <typename T>
-    void read_body_graphblas_coordinate(std::istream &instream,
-                                        matrix_market_header &header,
-                                        GrB_Matrix mat,
-                                        read_options options) {
+    void read_body_graphblas_coordinate_triplet(std::istream &instream,
+                                                matrix_market_header &header,
+                                                GrB_Matrix mat,
+                                                read_options options) {
         size_t storage_nnz = get_storage_nnz(header, options);
 
         // Read into triplets
@@ -595,6 +597,118 @@ namespace fast_matrix_market {
     }
 
 
+#if FMM_GXB_PACK_UNPACK
+    /**
+     * A malloc()-backed array that can be read into like a vector, then handed over to GraphBLAS.
+     */
+    template <typename T>
+    class graphblas_owned_array {
+    public:
+        using value_type = T;
+
+        graphblas_owned_array() = default;
+        ~graphblas_owned_array() {
+            free(ptr);
+        }
+
+        graphblas_owned_array(const graphblas_owned_array&) = delete;
+        graphblas_owned_array& operator=(const graphblas_owned_array&) = delete;
+
+        void resize(std::size_t n) {
+            // Always allocate, as GraphBLAS does not accept null arrays.
+            auto new_ptr = static_cast<T*>(realloc(ptr, std::max(n, (std::size_t)1) * sizeof(T)));
+            if (new_ptr == nullptr) {
+                throw std::bad_alloc();
+            }
+            ptr = new_ptr;
+            num = n;
+        }
+
+        [[nodiscard]] std::size_t size() const { return num; }
+        [[nodiscard]] GrB_Index size_bytes() const { return std::max(num, (std::size_t)1) * sizeof(T); }
+
+        T* begin() const { return ptr; }
+        T* end() const { return ptr + num; }
+        T& operator[](std::size_t i) const { return ptr[i]; }
+
+        /**
+         * Give up ownership. The caller must have GraphBLAS take it, or free() it.
+         */
+        void* release() {
+            void* ret = ptr;
+            ptr = nullptr;
+            num = 0;
+            return ret;
+        }
+
+    protected:
+        T* ptr = nullptr;
+        std::size_t num = 0;
+    };
+
+    /**
+     * Read a Matrix Market coordinate body into a sparse GraphBLAS matrix by packing CSR arrays.
+     *
+     * The CSR arrays are built with a parallel count and scatter straight from the parsed chunks, then handed to
+     * GraphBLAS with GxB_Matrix_pack_CSR. There are no intermediate triplets and GraphBLAS does not need to sort.
+     * Duplicates are summed, as with GrB_Matrix_build and GrB_PLUS.
+     */
+    template <typename T>
+    void read_body_graphblas_coordinate_pack(std::istream &instream,
+                                             matrix_market_header &header,
+                                             GrB_Matrix mat,
+                                             const read_options& options) {
+        graphblas_owned_array<GrB_Index> indptr, indices;
+        graphblas_owned_array<T> vals;
+
+        const T pattern_value = pattern_default_value(static_cast<T*>(nullptr));
+        read_matrix_market_body_compressed(instream, header, indptr, indices, vals, false, pattern_value, options);
+
+        int64_t nnz;
+        {
+            app_stage_timer timer(options, stage_convert);
+            nnz = sum_duplicates_compressed(indptr, indices, vals);
+        }
+        indices.resize(nnz);
+
+        bool iso = header.field == pattern;
+        if (iso) {
+            // Pattern matrices are iso-valued. Keep only the single value.
+            vals.resize(1);
+            vals[0] = pattern_value;
+        } else {
+            vals.resize(nnz);
+        }
+
+        auto Ap_size = indptr.size_bytes(), Aj_size = indices.size_bytes(), Ax_size = vals.size_bytes();
+        auto Ap = static_cast<GrB_Index*>(indptr.release());
+        auto Aj = static_cast<GrB_Index*>(indices.release());
+        auto Ax = vals.release();
+        GrB_Info info = GxB_Matrix_pack_CSR(mat, &Ap, &Aj, &Ax, Ap_size, Aj_size, Ax_size, iso, false, nullptr);
+
+        // On success GraphBLAS takes ownership and sets the pointers to null.
+        free(Ap);
+        free(Aj);
+        free(Ax);
+        ok(info);
+    }
+#endif
+
+    /**
+     * Read a Matrix Market coordinate body into a sparse GraphBLAS matrix.
+     */
+    template <typename T>
+    void read_body_graphblas_coordinate(std::istream &instream,
+                                        matrix_market_header &header,
+                                        GrB_Matrix mat,
+                                        const read_options& options) {
+#if FMM_GXB_PACK_UNPACK
+        read_body_graphblas_coordinate_pack<T>(instream, header, mat, options);
+#else
+        read_body_graphblas_coordinate_triplet<T>(instream, header, mat, options);
+#endif
+    }
+
     /**
      * Read a Matrix Market array body into a full GraphBLAS matrix.
      */
@@ -969,8 +1083,7 @@ namespace fast_matrix_market {
                     line_formatter(lf), mat(mat), kount_iter(kount_iter), kount_end(kount_end) {}
 
             std::string operator()() {
-                std::string chunk;
-                chunk.reserve((kount_end - kount_iter)*250);
+                chunk_output chunk((kount_end - kount_iter)*250);
 
                 GxB_Iterator iterator = IMPL::attach(mat);
 
@@ -986,7 +1099,7 @@ namespace fast_matrix_market {
                         auto[row, col] = IMPL::to_row_col(major, minor);
 
                         const T& value = GraphBLAS_typed<T>::GxB_Iterator_get(iterator);
-                        chunk += line_formatter.coord_matrix(row, col, value);
+                        line_formatter.coord_matrix(chunk, row, col, value);
 
                         // move to the next entry
                         info = IMPL::nextMinor(iterator);
@@ -996,7 +1109,7 @@ namespace fast_matrix_market {
                 }
                 GxB_Iterator_free(&iterator);
 
-                return chunk;
+                return chunk.release();
             }
 
             LF line_formatter;
@@ -87,6 +87,39 @@ namespace fast_matrix_market {
         read_matrix_market_array(instream, header, values, order, options);
     }
 
+    /**
+     * Read a Matrix Market file into an array.
+     *
+     * The file is memory-mapped and parsed in place. See mapped_istream.
+     */
+    template <array_read_vector VEC>
+    void read_matrix_market_array(const std::string& path,
+                                  matrix_market_header& header,
+                                  VEC& values,
+                                  storage_order order = row_major,
+                                  const read_options& options = {}) {
+        mapped_istream instream(path, options);
+        if (!instream.is_open()) {
+            throw invalid_argument("Cannot open file: " + path);
+        }
+        read_matrix_market_array(instream, header, values, order, options);
+    }
+
+    /**
+     * Convenience method that omits the header requirement if the user only cares about the dimensions.
+     */
+    template <array_read_vector VEC, typename DIM>
+    void read_matrix_market_array(const std::string& path,
+                                  DIM& nrows, DIM& ncols,
+                                  VEC& values,
+                                  storage_order order = row_major,
+                                  const read_options& options = {}) {
+        matrix_market_header header;
+        read_matrix_market_array(path, header, values, order, options);
+        nrows = header.nrows;
+        ncols = header.ncols;
+    }
+
     /**
      * Write an array to a Matrix Market file.
      */
@@ -118,6 +151,24 @@ namespace fast_matrix_market {
         write_body(os, formatter, options);
     }
 
+    /**
+     * Write an array to a Matrix Market file at `path`.
+     *
+     * Body chunks are written to the file concurrently. See pwrite_ostream.
+     */
+    template <array_write_vector VEC>
+    void write_matrix_market_array(const std::string& path,
+                                   const matrix_market_header& header,
+                                   const VEC& values,
+                                   storage_order order = row_major,
+                                   const write_options& options = {}) {
+        pwrite_ostream os(path);
+        if (!os.is_open()) {
+            throw invalid_argument("Cannot open file: " + path);
+        }
+        write_matrix_market_array(os, header, values, order, options);
+    }
+
 #if __cplusplus < 202002L || (defined(_MSVC_LANG) && _MSVC_LANG < 202002L)
 // clean up after ourselves
 #undef array_read_vector
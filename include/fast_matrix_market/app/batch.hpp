@@ -0,0 +1,108 @@
+// Copyright (C) 2023 Adam Lugowski. All rights reserved.
+// Use of this source code is governed by the BSD 2-clause license found in the LICENSE.txt file.
+// SPDX-License-Identifier: BSD-2-Clause
+
+#pragma once
+
+#include <span>
+
+#include "../fast_matrix_market.hpp"
+
+namespace fast_matrix_market {
+    /**
+     * A batch of parsed elements. See read_matrix_market_batches().
+     *
+     * The spans are only valid during the callback.
+     */
+    template <typename IT, typename VT>
+    struct element_batch {
+        /**
+         * Number of elements in all earlier batches.
+         */
+        int64_t first_element = 0;
+
+        std::span<const IT> rows;
+        std::span<const IT> cols;
+
+        /**
+         * Empty if the file is a pattern file.
+         */
+        std::span<const VT> values;
+
+        [[nodiscard]] std::size_t size() const {
+            return rows.size();
+        }
+    };
+
+    /**
+     * Passes each parsed chunk to a callable as an element_batch.
+     */
+    template <typename IT, typename VT, typename CALLABLE>
+    class batch_callback_parse_handler {
+    public:
+        using coordinate_type = IT;
+        using value_type = VT;
+        static constexpr int flags = kParallelOk | kAppending | kChunkBatches;
+
+        explicit batch_callback_parse_handler(CALLABLE& callable) : callable(callable) {}
+
+        template <typename BUFFER>
+        void handle_batch(const BUFFER& buffer) {
+            if (buffer.size() == 0) {
+                return;
+            }
+
+            element_batch<IT, VT> batch;
+            batch.first_element = num_elements;
+            batch.rows = buffer.get_rows();
+            batch.cols = buffer.get_cols();
+            batch.values = buffer.get_values();
+            num_elements += (int64_t)buffer.size();
+
+            callable(std::as_const(batch));
+        }
+
+    protected:
+        CALLABLE& callable;
+        int64_t num_elements = 0;
+    };
+
+    /**
+     * Read a coordinate Matrix Market file in batches, without storing the whole matrix.
+     *
+     * `callback(const element_batch<IT, VT>&)` is called once per parsed chunk, in file order, on the calling thread.
+     * Later chunks are parsed in parallel while it runs. Memory is bounded by the number of chunks in flight, so
+     * files larger than RAM can be aggregated. Use read_options::chunk_size_bytes to size the batches.
+     *
+     * Symmetry is generalized if read_options::generalize_symmetry is set. Diagonal elements are not duplicated.
+     */
+    template <typename IT, typename VT, typename CALLABLE>
+    void read_matrix_market_batches(std::istream &instream,
+                                    matrix_market_header& header,
+                                    CALLABLE callback,
+                                    const read_options& options = {}) {
+        read_header(instream, header);
+
+        if (header.format != coordinate) {
+            throw invalid_argument("Batched reads need a coordinate file.");
+        }
+#ifdef FMM_NO_VECTOR
+        if (header.object == vector) {
+            throw no_vector_support("Vector Matrix Market files not supported.");
+        }
+#endif
+        if (header.object == vector && header.symmetry != general) {
+            throw invalid_mm("Vectors cannot have symmetry.");
+        }
+        if (header.field == complex && !can_read_complex<VT>::value) {
+            throw complex_incompatible("Matrix Market file has complex fields but passed data structure cannot handle complex values.");
+        }
+
+        batch_callback_parse_handler<IT, VT, CALLABLE> handler(callback);
+        auto lc = read_body_threads_fused(instream, header, handler, options);
+        if (lc.element_num < header.nnz) {
+            throw invalid_mm(std::string("Truncated file. Expected another ") +
+                             std::to_string(header.nnz - lc.element_num) + " lines.");
+        }
+    }
+}
@@ -72,6 +72,36 @@ namespace fast_matrix_market {
         length = header.vector_length;
     }
 
+    /**
+     * Read a Matrix Market vector file into a doublet sparse vector (i.e. index, value vectors).
+     *
+     * The file is memory-mapped and parsed in place. See mapped_istream.
+     */
+    template <doublet_read_vector IVEC, doublet_read_vector VVEC>
+    void read_matrix_market_doublet(const std::string& path,
+                                    matrix_market_header& header,
+                                    IVEC& indices, VVEC& values,
+                                    const read_options& options = {}) {
+        mapped_istream instream(path, options);
+        if (!instream.is_open()) {
+            throw invalid_argument("Cannot open file: " + path);
+        }
+        read_matrix_market_doublet(instream, header, indices, values, options);
+    }
+
+    /**
+     * Convenience method that omits the header requirement if the user only cares about the dimensions.
+     */
+    template <doublet_read_vector IVEC, doublet_read_vector VVEC, typename DIM>
+    void read_matrix_market_doublet(const std::string& path,
+                                    DIM& length,
+                                    IVEC& indices, VVEC& values,
+                                    const read_options& options = {}) {
+        matrix_market_header header;
+        read_matrix_market_doublet(path, header, indices, values, options);
+        length = header.vector_length;
+    }
+
     /**
      * Write doublets to a Matrix Market file.
      */
@@ -104,6 +134,24 @@ namespace fast_matrix_market {
         write_body(os, formatter, options);
     }
 
+    /**
+     * Write doublets to a Matrix Market file at `path`.
+     *
+     * Body chunks are written to the file concurrently. See pwrite_ostream.
+     */
+    template <doublet_write_vector IVEC, doublet_write_vector VVEC>
+    void write_matrix_market_doublet(const std::string& path,
+                                     const matrix_market_header& header,
+                                     const IVEC& indices,
+                                     const VVEC& values,
+                                     const write_options& options = {}) {
+        pwrite_ostream os(path);
+        if (!os.is_open()) {
+            throw invalid_argument("Cannot open file: " + path);
+        }
+        write_matrix_market_doublet(os, header, indices, values, options);
+    }
+
 #if __cplusplus < 202002L || (defined(_MSVC_LANG) && _MSVC_LANG < 202002L)
     // clean up after ourselves
 #undef doublet_read_vector
@@ -32,17 +32,16 @@ namespace fast_matrix_market {
             }
 
             std::string operator()() {
-                std::string chunk;
-                chunk.reserve(chunk_nnz*25);
+                chunk_output chunk(chunk_nnz*25);
                 
                 for (int64_t i = 0; i < chunk_nnz; ++i) {
                     IT row, col;
                     VT value;
                     gen_callable(chunk_offset + i, row, col, value);
-                    chunk += line_formatter.coord_matrix(row, col, value);
+                    line_formatter.coord_matrix(chunk, row, col, value);
                 }
 
-                return chunk;
+                return chunk.release();
             }
 
             LF line_formatter;
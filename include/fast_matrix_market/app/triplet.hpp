@@ -80,12 +80,134 @@ namespace fast_matrix_market {
         }
     }
 
+    /**
+     * Remove the triplet elements that fall outside the window selected by `options`. Compacts in place.
+     */
+    template <typename IVEC, typename VVEC>
+    void filter_triplet_window(IVEC& rows, IVEC& cols, VVEC& values, const read_options& options) {
+        if (!has_window_filter(options)) {
+            return;
+        }
+        auto end_or_max = [](int64_t end) {
+            return end < 0 ? std::numeric_limits<int64_t>::max() : end;
+        };
+        const int64_t row_end = end_or_max(options.filter_row_end);
+        const int64_t col_end = end_or_max(options.filter_col_end);
+
+        std::size_t out = 0;
+        for (std::size_t i = 0; i < rows.size(); ++i) {
+            auto row = (int64_t)rows[i];
+            auto col = (int64_t)cols[i];
+            if (row >= options.filter_row_begin && row < row_end && col >= options.filter_col_begin && col < col_end) {
+                rows[out] = rows[i];
+                cols[out] = cols[i];
+                values[out] = values[i];
+                ++out;
+            }
+        }
+        rows.resize(out);
+        cols.resize(out);
+        values.resize(out);
+    }
+
+    /**
+     * Read a Matrix Market body into a triplet, keeping only the elements in the window selected by `options`.
+     * See read_options::filter_row_begin.
+     *
+     * Coordinate bodies are parsed with read_body_threads_fused(), and each chunk is filtered as it is copied out of
+     * chunk-local storage. The parse kernels are the same as for an unfiltered fused read.
+     *
+     * Symmetry is generalized after the read, so diagonal elements are not duplicated.
+     */
+    template <triplet_read_vector IVEC, triplet_read_vector VVEC, typename T>
+    void read_matrix_market_body_triplet_filtered(std::istream &instream,
+                                                  const matrix_market_header& header,
+                                                  IVEC& rows, IVEC& cols, VVEC& values,
+                                                  T pattern_value,
+                                                  read_options options = {}) {
+        using IT = typename std::iterator_traits<decltype(rows.begin())>::value_type;
+        using VT = typename std::iterator_traits<decltype(values.begin())>::value_type;
+
+        bool generalize = options.generalize_symmetry;
+        options.generalize_symmetry = false;
+
+        if (header.format != coordinate) {
+            // Every element of an array body is stored anyway. Read it all, then compact.
+            read_options all_options = options;
+            all_options.filter_row_begin = all_options.filter_col_begin = 0;
+            all_options.filter_row_end = all_options.filter_col_end = -1;
+            read_matrix_market_body_triplet(instream, header, rows, cols, values, pattern_value, all_options);
+        } else {
+#ifdef FMM_NO_VECTOR
+            if (header.object == vector) {
+                throw no_vector_support("Vector Matrix Market files not supported.");
+            }
+#endif
+            if (header.object == vector && header.symmetry != general) {
+                throw invalid_mm("Vectors cannot have symmetry.");
+            }
+            if (header.field == complex && !can_read_complex<VT>::value) {
+                throw complex_incompatible("Matrix Market file has complex fields but passed data structure cannot handle complex values.");
+            }
+
+            window_filter_parse_handler<IT, VT> handler(options, generalize && header.symmetry != general);
+            auto fwd_handler = pattern_parse_adapter<decltype(handler)>(handler, pattern_value);
+            auto lc = read_body_threads_fused(instream, header, fwd_handler, options);
+            if (lc.element_num < header.nnz) {
+                throw invalid_mm(std::string("Truncated file. Expected another ") +
+                                 std::to_string(header.nnz - lc.element_num) + " lines.");
+            }
+
+            // Concatenate the kept elements of each chunk.
+            auto chunks = handler.chunks();
+            std::vector<int64_t> offsets(chunks.size() + 1, 0);
+            for (std::size_t i = 0; i < chunks.size(); ++i) {
+                offsets[i + 1] = offsets[i] + (int64_t)chunks[i]->size();
+            }
+            rows.resize(offsets.back());
+            cols.resize(offsets.back());
+            values.resize(offsets.back());
+
+            auto replay_chunk = [&](std::size_t i) {
+                auto out = triplet_parse_handler(rows.begin() + offsets[i], cols.begin() + offsets[i], values.begin() + offsets[i]);
+                chunks[i]->replay(out);
+            };
+
+            bool threads = limit_parallelism_for_value_type<VT>(options.parallel_ok && options.num_threads != 1);
+            if (!threads || chunks.size() < 2) {
+                for (std::size_t i = 0; i < chunks.size(); ++i) {
+                    replay_chunk(i);
+                }
+            } else {
+                scoped_thread_pool pool(options);
+                std::vector<std::future<void>> futures;
+                for (std::size_t i = 0; i < chunks.size(); ++i) {
+                    futures.push_back(pool.submit(replay_chunk, i));
+                }
+                for (auto& future : futures) {
+                    future.get();
+                }
+            }
+        }
+
+        if (generalize) {
+            app_stage_timer timer(options, stage_generalize_symmetry);
+            generalize_symmetry_triplet(rows, cols, values, header.symmetry);
+        }
+        filter_triplet_window(rows, cols, values, options);
+    }
+
     template <triplet_read_vector IVEC, triplet_read_vector VVEC, typename T>
     void read_matrix_market_body_triplet(std::istream &instream,
                                          const matrix_market_header& header,
                                          IVEC& rows, IVEC& cols, VVEC& values,
                                          T pattern_value,
                                          read_options options = {}) {
+        if (has_window_filter(options)) {
+            read_matrix_market_body_triplet_filtered(instream, header, rows, cols, values, pattern_value, options);
+            return;
+        }
+
         bool app_generalize = false;
         if (options.generalize_symmetry && options.generalize_symmetry_app) {
             app_generalize = true;
@@ -101,6 +223,7 @@ namespace fast_matrix_market {
         read_matrix_market_body(instream, header, handler, pattern_value, options);
 
         if (app_generalize) {
+            app_stage_timer timer(options, stage_generalize_symmetry);
             generalize_symmetry_triplet(rows, cols, values, header.symmetry);
         }
     }
@@ -133,6 +256,460 @@ namespace fast_matrix_market {
         ncols = header.ncols;
     }
 
+    /**
+     * Read a Matrix Market file into a triplet through its binary cache. See read_options::binary_cache.
+     *
+     * If the cache is missing or stale the file is parsed and the cache is rewritten.
+     */
+    template <triplet_read_vector IVEC, triplet_read_vector VVEC>
+    void read_matrix_market_triplet_binary_cache(const std::string& path,
+                                                 matrix_market_header& header,
+                                                 IVEC& rows, IVEC& cols, VVEC& values,
+                                                 const read_options& options = {}) {
+        using IT = typename std::iterator_traits<decltype(rows.begin())>::value_type;
+        using VT = typename std::iterator_traits<decltype(values.begin())>::value_type;
+
+        binary_cache_key key;
+        bool have_key = get_binary_cache_key(path, key);
+        auto cache_path = binary_cache_path(path);
+
+        // The cache holds the body as written in the file. Symmetry is generalized after loading it.
+        bool loaded = false;
+        if (have_key) {
+            mapped_binary_cache cache(cache_path);
+            if (cache.matches<IT, VT>(key)) {
+                header = cache.get_header();
+                auto length = cache.length();
+                rows.resize(length);
+                cols.resize(length);
+                values.resize(length);
+                copy_binary_cache_array(cache.rows<IT>(), length, rows.begin(), options);
+                copy_binary_cache_array(cache.cols<IT>(), length, cols.begin(), options);
+                copy_binary_cache_array(cache.values<VT>(), length, values.begin(), options);
+                loaded = true;
+            }
+        }
+
+        if (!loaded) {
+            mapped_istream instream(path, options);
+            if (!instream.is_open()) {
+                throw invalid_argument("Cannot open file: " + path);
+            }
+            read_options raw_options = options;
+            raw_options.generalize_symmetry = false;
+            read_matrix_market_triplet(instream, header, rows, cols, values, raw_options);
+
+            if (have_key) {
+                // A cache that cannot be written only costs the next read a parse.
+                write_binary_cache(cache_path, key, header, rows.begin(), cols.begin(), values.begin(), rows.size());
+            }
+        }
+
+        if (options.generalize_symmetry) {
+            app_stage_timer timer(options, stage_generalize_symmetry);
+            generalize_symmetry_triplet(rows, cols, values, header.symmetry);
+        }
+    }
+
+    /**
+     * Read a Matrix Market file into a triplet (i.e. row, column, value vectors).
+     *
+     * The file is memory-mapped and parsed in place. See mapped_istream.
+     */
+    template <triplet_read_vector IVEC, triplet_read_vector VVEC>
+    void read_matrix_market_triplet(const std::string& path,
+                                    matrix_market_header& header,
+                                    IVEC& rows, IVEC& cols, VVEC& values,
+                                    const read_options& options = {}) {
+        using IT = typename std::iterator_traits<decltype(rows.begin())>::value_type;
+        using VT = typename std::iterator_traits<decltype(values.begin())>::value_type;
+        if (use_binary_cache<IT, VT>(options)) {
+            read_matrix_market_triplet_binary_cache(path, header, rows, cols, values, options);
+            return;
+        }
+
+        mapped_istream instream(path, options);
+        if (!instream.is_open()) {
+            throw invalid_argument("Cannot open file: " + path);
+        }
+        read_matrix_market_triplet(instream, header, rows, cols, values, options);
+    }
+
+    /**
+     * Convenience method that omits the header requirement if the user only cares about the dimensions.
+     */
+    template <triplet_read_vector IVEC, triplet_read_vector VVEC, typename DIM>
+    void read_matrix_market_triplet(const std::string& path,
+                                    DIM& nrows, DIM& ncols,
+                                    IVEC& rows, IVEC& cols, VVEC& values,
+                                    const read_options& options = {}) {
+        matrix_market_header header;
+        read_matrix_market_triplet(path, header, rows, cols, values, options);
+        nrows = header.nrows;
+        ncols = header.ncols;
+    }
+
+    /**
+     * Read elements [first, last) of a coordinate Matrix Market file into a triplet.
+     *
+     * Only the lines of those elements are read, located using `index`. See build_line_index(). Elements are
+     * numbered in file order, so disjoint ranges can be read by separate workers and a partial load can be resumed.
+     *
+     * If options.generalize_symmetry is set then the elements in the range are generalized as by
+     * generalize_symmetry_triplet(). A filter window is then applied to the result.
+     *
+     * @param header filled with the file's header.
+     */
+    template <triplet_read_vector IVEC, triplet_read_vector VVEC>
+    void read_matrix_market_triplet_range(const std::string& path, const line_index& index,
+                                          int64_t first, int64_t last,
+                                          matrix_market_header& header,
+                                          IVEC& rows, IVEC& cols, VVEC& values,
+                                          const read_options& options = {}) {
+        using VT = typename std::iterator_traits<decltype(values.begin())>::value_type;
+
+        auto span = read_line_index_span(path, index, first, last, header);
+
+        memory_streambuf span_buf(span.bytes.data(), span.bytes.data() + span.bytes.size());
+        std::istream span_stream(&span_buf);
+        read_options raw_options = options;
+        raw_options.generalize_symmetry = false;
+        raw_options.filter_row_begin = raw_options.filter_col_begin = 0;
+        raw_options.filter_row_end = raw_options.filter_col_end = -1;
+        read_matrix_market_body_triplet(span_stream, span.header, rows, cols, values, pattern_default_value((const VT*)nullptr), raw_options);
+
+        // The span starts and ends on index entries. Drop the elements outside of the range.
+        auto skip = first - span.first_element;
+        auto length = last - first;
+        if (skip > 0) {
+            std::move(rows.begin() + skip, rows.begin() + skip + length, rows.begin());
+            std::move(cols.begin() + skip, cols.begin() + skip + length, cols.begin());
+            std::move(values.begin() + skip, values.begin() + skip + length, values.begin());
+        }
+        rows.resize(length);
+        cols.resize(length);
+        values.resize(length);
+
+        if (options.generalize_symmetry) {
+            app_stage_timer timer(options, stage_generalize_symmetry);
+            generalize_symmetry_triplet(rows, cols, values, header.symmetry);
+        }
+        filter_triplet_window(rows, cols, values, options);
+    }
+
+    /**
+     * Sort the indices (and values) of each row or column of a compressed matrix.
+     */
+    template <typename IVEC, typename VVEC>
+    void sort_compressed_segments(const IVEC& indptr, IVEC& indices, VVEC& values, const read_options& options) {
+        using IT = typename std::iterator_traits<decltype(indices.begin())>::value_type;
+        using VT = typename std::iterator_traits<decltype(values.begin())>::value_type;
+
+        auto sort_range = [&](int64_t first_major, int64_t last_major) {
+            std::vector<std::pair<IT, VT>> scratch;
+            for (int64_t major = first_major; major < last_major; ++major) {
+                auto begin = (int64_t)indptr[major];
+                auto end = (int64_t)indptr[major + 1];
+
+                if (end - begin <= 32) {
+                    // Short segments are common, and insertion sort needs no scratch space.
+                    for (auto i = begin + 1; i < end; ++i) {
+                        IT index = indices[i];
+                        VT value = values[i];
+                        auto j = i;
+                        for (; j > begin && index < indices[j - 1]; --j) {
+                            indices[j] = indices[j - 1];
+                            values[j] = values[j - 1];
+                        }
+                        indices[j] = index;
+                        values[j] = value;
+                    }
+                    continue;
+                }
+
+                scratch.clear();
+                for (auto i = begin; i < end; ++i) {
+                    scratch.emplace_back(indices[i], values[i]);
+                }
+                std::sort(scratch.begin(), scratch.end(),
+                          [](const auto& lhs, const auto& rhs) { return lhs.first < rhs.first; });
+                for (auto i = begin; i < end; ++i) {
+                    indices[i] = scratch[i - begin].first;
+                    values[i] = scratch[i - begin].second;
+                }
+            }
+        };
+
+        auto num_major = (int64_t)indptr.size() - 1;
+        auto nnz = (int64_t)indices.size();
+        if (!options.parallel_ok || options.num_threads == 1 || nnz < (1 << 16)) {
+            sort_range(0, num_major);
+            return;
+        }
+
+        // Split into ranges with roughly equal numbers of elements.
+        scoped_thread_pool pool(options);
+        auto num_ranges = (int64_t)pool.get_num_threads() * 4;
+        std::vector<std::future<void>> futures;
+        int64_t first_major = 0;
+        for (int64_t range = 1; range <= num_ranges && first_major < num_major; ++range) {
+            auto target = nnz * range / num_ranges;
+            auto last_major = first_major;
+            while (last_major < num_major && ((int64_t)indptr[last_major] < target || last_major == first_major)) {
+                ++last_major;
+            }
+            if (range == num_ranges) {
+                last_major = num_major;
+            }
+            futures.push_back(pool.submit(sort_range, first_major, last_major));
+            first_major = last_major;
+        }
+        for (auto& future : futures) {
+            future.get();
+        }
+    }
+
+    /**
+     * Sum duplicate elements of a compressed matrix with sorted indices. Compacts in place.
+     *
+     * @return the new number of elements. Callers should resize `indices` and `values` to this size.
+     */
+    template <typename IVEC, typename VVEC>
+    int64_t sum_duplicates_compressed(IVEC& indptr, IVEC& indices, VVEC& values) {
+        using IT = typename std::iterator_traits<decltype(indptr.begin())>::value_type;
+
+        auto num_major = (int64_t)indptr.size() - 1;
+        int64_t out = 0;
+        int64_t begin = num_major < 0 ? 0 : (int64_t)indptr[0];
+        for (int64_t major = 0; major < num_major; ++major) {
+            auto end = (int64_t)indptr[major + 1];
+            indptr[major] = (IT)out;
+            for (auto i = begin; i < end; ++i) {
+                if (i > begin && indices[i] == indices[out - 1]) {
+                    values[out - 1] += values[i];
+                } else {
+                    indices[out] = indices[i];
+                    values[out] = values[i];
+                    ++out;
+                }
+            }
+            begin = end;
+        }
+        if (num_major >= 0) {
+            indptr[num_major] = (IT)out;
+        }
+        return out;
+    }
+
+    /**
+     * Build a compressed sparse (CSR or CSC) matrix from triplets with a counting sort.
+     *
+     * Duplicate elements are kept. Indices within each row (or column) are sorted.
+     *
+     * @param compress_columns true for CSC, false for CSR.
+     */
+    template <typename TIVEC, typename TVVEC, typename IVEC, typename VVEC>
+    void triplet_to_compressed(const TIVEC& rows, const TIVEC& cols, const TVVEC& triplet_values,
+                               int64_t num_major, bool compress_columns,
+                               IVEC& indptr, IVEC& indices, VVEC& values,
+                               const read_options& options) {
+        using IT = typename std::iterator_traits<decltype(indices.begin())>::value_type;
+        app_stage_timer timer(options, stage_convert);
+
+        const auto& major = compress_columns ? cols : rows;
+        const auto& minor = compress_columns ? rows : cols;
+        auto nnz = (int64_t)rows.size();
+
+        std::vector<int64_t> cursors(num_major, 0);
+        for (int64_t i = 0; i < nnz; ++i) {
+            ++cursors[(std::size_t)major[i]];
+        }
+
+        indptr.resize(num_major + 1);
+        int64_t offset = 0;
+        for (int64_t i = 0; i < num_major; ++i) {
+            indptr[i] = (IT)offset;
+            auto count = cursors[i];
+            cursors[i] = offset;
+            offset += count;
+        }
+        indptr[num_major] = (IT)offset;
+
+        indices.resize(nnz);
+        values.resize(nnz);
+        for (int64_t i = 0; i < nnz; ++i) {
+            auto pos = cursors[(std::size_t)major[i]]++;
+            indices[pos] = (IT)minor[i];
+            values[pos] = triplet_values[i];
+        }
+
+        sort_compressed_segments(indptr, indices, values, options);
+    }
+
+    /**
+     * Read a Matrix Market body directly into a compressed sparse (CSR or CSC) matrix.
+     *
+     * The body is parsed twice. The first pass counts the elements in each row (or column), the second pass places
+     * each element directly into its final position. No intermediate triplets are materialized and no comparison
+     * sort over all elements is needed. Indices within each row (or column) are sorted.
+     *
+     * Duplicate elements are kept.
+     *
+     * A memory-mapped body is parsed in place. A body from any other stream is read into memory first.
+     *
+     * @param compress_columns true for CSC, false for CSR.
+     */
+    template <triplet_read_vector IVEC, triplet_read_vector VVEC, typename T>
+    void read_matrix_market_body_compressed(std::istream &instream,
+                                            const matrix_market_header& header,
+                                            IVEC& indptr, IVEC& indices, VVEC& values,
+                                            bool compress_columns,
+                                            T pattern_value,
+                                            read_options options = {}) {
+        using IT = typename std::iterator_traits<decltype(indices.begin())>::value_type;
+        using VT = typename std::iterator_traits<decltype(values.begin())>::value_type;
+
+        // Symmetry is generalized by the parse handlers.
+        options.generalize_symmetry_app = false;
+
+        std::string body_buffer;
+        std::string_view body;
+        chunk_reader reader(instream, options);
+        if (reader.is_memory_backed()) {
+            body = reader.take_remaining();
+        } else {
+            body_buffer.assign(std::istreambuf_iterator<char>(instream), std::istreambuf_iterator<char>());
+            body = body_buffer;
+        }
+
+        auto parse_pass = [&](auto& handler) {
+            memory_streambuf body_buf(body.data(), body.data() + body.size());
+            std::istream body_stream(&body_buf);
+            read_matrix_market_body(body_stream, header, handler, pattern_value, options);
+        };
+
+        // Pass 1: count
+        auto num_major = (std::size_t)(compress_columns ? header.ncols : header.nrows);
+        std::unique_ptr<std::atomic<int64_t>[]> counts(new std::atomic<int64_t>[num_major]);
+        for (std::size_t i = 0; i < num_major; ++i) {
+            counts[i].store(0, std::memory_order_relaxed);
+        }
+        {
+            auto handler = compressed_count_parse_handler<IT, VT>(counts.get(), compress_columns);
+            parse_pass(handler);
+        }
+
+        // Exclusive prefix sum. The counts become the cursors for the second pass.
+        indptr.resize(num_major + 1);
+        int64_t nnz = 0;
+        for (std::size_t i = 0; i < num_major; ++i) {
+            indptr[i] = (IT)nnz;
+            auto count = counts[i].load(std::memory_order_relaxed);
+            counts[i].store(nnz, std::memory_order_relaxed);
+            nnz += count;
+        }
+        indptr[num_major] = (IT)nnz;
+
+        // Pass 2: scatter
+        indices.resize(nnz);
+        values.resize(nnz);
+        {
+            auto handler = compressed_scatter_parse_handler(counts.get(), compress_columns, indices.begin(), values.begin());
+            parse_pass(handler);
+        }
+
+        app_stage_timer timer(options, stage_convert);
+        sort_compressed_segments(indptr, indices, values, options);
+    }
+
+    /**
+     * Read a Matrix Market file into a CSR matrix (i.e. indptr, column indices, values vectors).
+     *
+     * See read_matrix_market_body_compressed().
+     */
+    template <triplet_read_vector IVEC, triplet_read_vector VVEC>
+    void read_matrix_market_csr(std::istream &instream,
+                                matrix_market_header& header,
+                                IVEC& indptr, IVEC& indices, VVEC& values,
+                                const read_options& options = {}) {
+        read_header(instream, header);
+
+        using VT = typename std::iterator_traits<decltype(values.begin())>::value_type;
+        read_matrix_market_body_compressed(instream, header, indptr, indices, values, false, pattern_default_value((const VT*)nullptr), options);
+    }
+
+    /**
+     * Read a Matrix Market file into a CSC matrix (i.e. indptr, row indices, values vectors).
+     *
+     * See read_matrix_market_body_compressed().
+     */
+    template <triplet_read_vector IVEC, triplet_read_vector VVEC>
+    void read_matrix_market_csc(std::istream &instream,
+                                matrix_market_header& header,
+                                IVEC& indptr, IVEC& indices, VVEC& values,
+                                const read_options& options = {}) {
+        read_header(instream, header);
+
+        using VT = typename std::iterator_traits<decltype(values.begin())>::value_type;
+        read_matrix_market_body_compressed(instream, header, indptr, indices, values, true, pattern_default_value((const VT*)nullptr), options);
+    }
+
+    /**
+     * Read a Matrix Market file into a CSR matrix.
+     *
+     * The file is memory-mapped and parsed in place. See mapped_istream.
+     */
+    template <triplet_read_vector IVEC, triplet_read_vector VVEC>
+    void read_matrix_market_csr(const std::string& path,
+                                matrix_market_header& header,
+                                IVEC& indptr, IVEC& indices, VVEC& values,
+                                const read_options& options = {}) {
+        using IT = typename std::iterator_traits<decltype(indices.begin())>::value_type;
+        using VT = typename std::iterator_traits<decltype(values.begin())>::value_type;
+        if (use_binary_cache<IT, VT>(options)) {
+            std::vector<IT> rows, cols;
+            std::vector<VT> triplet_values;
+            read_matrix_market_triplet_binary_cache(path, header, rows, cols, triplet_values, options);
+            triplet_to_compressed(rows, cols, triplet_values, header.nrows, false,
+                                  indptr, indices, values, options);
+            return;
+        }
+
+        mapped_istream instream(path, options);
+        if (!instream.is_open()) {
+            throw invalid_argument("Cannot open file: " + path);
+        }
+        read_matrix_market_csr(instream, header, indptr, indices, values, options);
+    }
+
+    /**
+     * Read a Matrix Market file into a CSC matrix.
+     *
+     * The file is memory-mapped and parsed in place. See mapped_istream.
+     */
+    template <triplet_read_vector IVEC, triplet_read_vector VVEC>
+    void read_matrix_market_csc(const std::string& path,
+                                matrix_market_header& header,
+                                IVEC& indptr, IVEC& indices, VVEC& values,
+                                const read_options& options = {}) {
+        using IT = typename std::iterator_traits<decltype(indices.begin())>::value_type;
+        using VT = typename std::iterator_traits<decltype(values.begin())>::value_type;
+        if (use_binary_cache<IT, VT>(options)) {
+            std::vector<IT> rows, cols;
+            std::vector<VT> triplet_values;
+            read_matrix_market_triplet_binary_cache(path, header, rows, cols, triplet_values, options);
+            triplet_to_compressed(rows, cols, triplet_values, header.ncols, true,
+                                  indptr, indices, values, options);
+            return;
+        }
+
+        mapped_istream instream(path, options);
+        if (!instream.is_open()) {
+            throw invalid_argument("Cannot open file: " + path);
+        }
+        read_matrix_market_csc(instream, header, indptr, indices, values, options);
+    }
+
     /**
      * Write triplets to a Matrix Market file.
      */
@@ -201,6 +778,45 @@ namespace fast_matrix_market {
         write_body(os, formatter, options);
     }
 
+    /**
+     * Write triplets to a Matrix Market file at `path`.
+     *
+     * Body chunks are written to the file concurrently. See pwrite_ostream.
+     */
+    template <triplet_write_vector IVEC, triplet_write_vector VVEC>
+    void write_matrix_market_triplet(const std::string& path,
+                                     const matrix_market_header& header,
+                                     const IVEC& rows,
+                                     const IVEC& cols,
+                                     const VVEC& values,
+                                     const write_options& options = {}) {
+        pwrite_ostream os(path);
+        if (!os.is_open()) {
+            throw invalid_argument("Cannot open file: " + path);
+        }
+        write_matrix_market_triplet(os, header, rows, cols, values, options);
+    }
+
+    /**
+     * Write CSC/CSR to a Matrix Market file at `path`.
+     *
+     * Body chunks are written to the file concurrently. See pwrite_ostream.
+     */
+    template <triplet_write_vector IVEC, triplet_write_vector VVEC>
+    void write_matrix_market_csc(const std::string& path,
+                                 const matrix_market_header& header,
+                                 const IVEC& indptr,
+                                 const IVEC& indices,
+                                 const VVEC& values,
+                                 bool is_csr,
+                                 const write_options& options = {}) {
+        pwrite_ostream os(path);
+        if (!os.is_open()) {
+            throw invalid_argument("Cannot open file: " + path);
+        }
+        write_matrix_market_csc(os, header, indptr, indices, values, is_csr, options);
+    }
+
 #if __cplusplus < 202002L || (defined(_MSVC_LANG) && _MSVC_LANG < 202002L)
     // clean up after ourselves
 #undef triplet_read_vector
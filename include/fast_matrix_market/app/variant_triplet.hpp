@@ -0,0 +1,113 @@
+// Copyright (C) 2023 Adam Lugowski. All rights reserved.
+// Use of this source code is governed by the BSD 2-clause license found in the LICENSE.txt file.
+// SPDX-License-Identifier: BSD-2-Clause
+
+#pragma once
+
+#include <complex>
+#include <cstdint>
+#include <limits>
+#include <variant>
+#include <vector>
+
+#include "../fast_matrix_market.hpp"
+
+namespace fast_matrix_market {
+    /**
+     * Triplet (i.e. row, column, value vectors) with fixed index and value types.
+     */
+    template <typename IT, typename VT>
+    struct triplet_vectors {
+        using index_type = IT;
+        using value_type = VT;
+
+        std::vector<IT> rows;
+        std::vector<IT> cols;
+        std::vector<VT> values;
+    };
+
+    /**
+     * Triplet with index and value types chosen at runtime. See read_matrix_market_triplet_variant().
+     */
+    using variant_triplet = std::variant<
+            triplet_vectors<uint16_t, float>,
+            triplet_vectors<uint16_t, double>,
+            triplet_vectors<uint16_t, std::complex<float>>,
+            triplet_vectors<uint16_t, std::complex<double>>,
+            triplet_vectors<uint32_t, float>,
+            triplet_vectors<uint32_t, double>,
+            triplet_vectors<uint32_t, std::complex<float>>,
+            triplet_vectors<uint32_t, std::complex<double>>,
+            triplet_vectors<int64_t, float>,
+            triplet_vectors<int64_t, double>,
+            triplet_vectors<int64_t, std::complex<float>>,
+            triplet_vectors<int64_t, std::complex<double>>>;
+
+    template <typename IT, typename VT>
+    variant_triplet read_matrix_market_body_variant_triplet(std::istream &instream,
+                                                            const matrix_market_header& header,
+                                                            const read_options& options) {
+        triplet_vectors<IT, VT> triplet;
+        read_matrix_market_body_triplet(instream, header, triplet.rows, triplet.cols, triplet.values,
+                                        pattern_default_value((const VT*)nullptr), options);
+        return triplet;
+    }
+
+    template <typename IT>
+    variant_triplet read_matrix_market_body_variant_triplet(std::istream &instream,
+                                                            const matrix_market_header& header,
+                                                            value_precision precision,
+                                                            const read_options& options) {
+        if (header.field == complex) {
+            if (precision == SinglePrecision) {
+                return read_matrix_market_body_variant_triplet<IT, std::complex<float>>(instream, header, options);
+            }
+            return read_matrix_market_body_variant_triplet<IT, std::complex<double>>(instream, header, options);
+        }
+
+        if (precision == SinglePrecision) {
+            return read_matrix_market_body_variant_triplet<IT, float>(instream, header, options);
+        }
+        return read_matrix_market_body_variant_triplet<IT, double>(instream, header, options);
+    }
+
+    /**
+     * Read a Matrix Market file into a triplet with the narrowest index type that fits the dimensions in the
+     * header: uint16_t, uint32_t, or int64_t.
+     *
+     * Values are float or double according to `precision`, or std::complex of those for complex files.
+     * Integer and pattern files are read as real values.
+     */
+    inline variant_triplet read_matrix_market_triplet_variant(std::istream &instream,
+                                                              matrix_market_header& header,
+                                                              value_precision precision = DoublePrecision,
+                                                              const read_options& options = {}) {
+        read_header(instream, header);
+
+        // Indices are parsed one-based, so the largest dimension must fit.
+        auto max_dim = std::max(header.nrows, header.ncols);
+        if (max_dim <= std::numeric_limits<uint16_t>::max()) {
+            return read_matrix_market_body_variant_triplet<uint16_t>(instream, header, precision, options);
+        } else if (max_dim <= std::numeric_limits<uint32_t>::max()) {
+            return read_matrix_market_body_variant_triplet<uint32_t>(instream, header, precision, options);
+        } else {
+            return read_matrix_market_body_variant_triplet<int64_t>(instream, header, precision, options);
+        }
+    }
+
+    /**
+     * Read a Matrix Market file into a triplet with the narrowest index type that fits.
+     *
+     * The file is memory-mapped and parsed in place. See mapped_istream.
+     */
+    inline variant_triplet read_matrix_market_triplet_variant(const std::string& path,
+                                                              matrix_market_header& header,
+                                                              value_precision precision = DoublePrecision,
+                                                              const read_options& options = {}) {
+        mapped_istream instream(path, options);
+        if (!instream.is_open()) {
+            throw invalid_argument("Cannot open file: " + path);
+        }
+        return read_matrix_market_triplet_variant(instream, header, precision, options);
+    }
+}
@@ -0,0 +1,355 @@
+// Copyright (C) 2023 Adam Lugowski. All rights reserved.
+// Use of this source code is governed by the BSD 2-clause license found in the LICENSE.txt file.
+// SPDX-License-Identifier: BSD-2-Clause
+
+#pragma once
+
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <random>
+#include <string>
+#include <type_traits>
+#include <vector>
+
+#include "fast_matrix_market.hpp"
+#include "mapped_file.hpp"
+#include "thread_pool.hpp"
+
+namespace fast_matrix_market {
+
+    /**
+     * Identifies the version of a source .mtx file that a binary cache was made from.
+     */
+    struct binary_cache_key {
+        uint64_t size = 0;
+        int64_t mtime = 0;
+        uint64_t hash = 0;
+
+        bool operator==(const binary_cache_key& rhs) const {
+            return size == rhs.size && mtime == rhs.mtime && hash == rhs.hash;
+        }
+    };
+
+    /**
+     * Type tag of a cacheable array element: kind * 256 + size in bytes. 0 means the type cannot be cached.
+     */
+    template <typename T>
+    constexpr uint32_t binary_cache_type_tag() {
+        if constexpr (std::is_same_v<T, bool>) {
+            return 0;
+        } else if constexpr (std::is_integral_v<T>) {
+            return (std::is_signed_v<T> ? 1 : 2) * 256 + sizeof(T);
+        } else if constexpr (std::is_floating_point_v<T>) {
+            return 3 * 256 + sizeof(T);
+        } else if constexpr (is_complex<T>::value) {
+            return std::is_floating_point_v<typename T::value_type> ? 4 * 256 + sizeof(T) : 0;
+        } else {
+            return 0;
+        }
+    }
+
+    /**
+     * @return true if a read into index type IT and value type VT with these options uses the binary cache.
+     */
+    template <typename IT, typename VT>
+    bool use_binary_cache(const read_options& options) {
+        return options.binary_cache && !has_window_filter(options) &&
+               (!options.generalize_symmetry || options.generalize_symmetry_app) &&
+               binary_cache_type_tag<IT>() != 0 && binary_cache_type_tag<VT>() != 0;
+    }
+
+    /**
+     * The sidecar cache file of a .mtx file.
+     */
+    inline std::string binary_cache_path(const std::string& path) {
+        return path + ".fmmcache";
+    }
+
+    /**
+     * Compute the cache key of a source file: its size, modification time, and a hash of its first and last
+     * 64 KiB. Hashing the whole file would cost as much I/O as parsing it.
+     *
+     * @return false if the file cannot be read.
+     */
+    inline bool get_binary_cache_key(const std::string& path, binary_cache_key& key) {
+        std::error_code ec;
+        auto size = std::filesystem::file_size(path, ec);
+        if (ec) {
+            return false;
+        }
+        auto mtime = std::filesystem::last_write_time(path, ec);
+        if (ec) {
+            return false;
+        }
+
+        key.size = size;
+        key.mtime = static_cast<int64_t>(mtime.time_since_epoch().count());
+
+        std::ifstream f(path, std::ios_base::binary);
+        if (!f) {
+            return false;
+        }
+
+        constexpr std::size_t kSampleSize = 64 << 10;
+        std::vector<char> sample(static_cast<std::size_t>(std::min<uint64_t>(size, 2 * kSampleSize)));
+        if (size <= 2 * kSampleSize) {
+            f.read(sample.data(), static_cast<std::streamsize>(sample.size()));
+        } else {
+            f.read(sample.data(), kSampleSize);
+            f.seekg(static_cast<std::streamoff>(size - kSampleSize));
+            f.read(sample.data() + kSampleSize, kSampleSize);
+        }
+        if (!f) {
+            return false;
+        }
+
+        // FNV-1a
+        uint64_t hash = 14695981039346656037ULL;
+        for (char c : sample) {
+            hash = (hash ^ static_cast<unsigned char>(c)) * 1099511628211ULL;
+        }
+        key.hash = hash;
+        return true;
+    }
+
+    /**
+     * Layout of the start of a binary cache file.
+     *
+     * The header is followed by the comment, then the row, column, and value arrays. Each array starts at an offset
+     * that is a multiple of kBinaryCacheAlignment so it can be used in place from a memory mapping. The file is in
+     * the native byte order. A file written on a machine with a different byte order fails the magic check.
+     */
+    struct binary_cache_file_header {
+        char magic[8];
+        uint32_t byte_order;
+        uint32_t version;
+        uint32_t index_type;
+        uint32_t value_type;
+
+        binary_cache_key key;
+
+        int32_t object;
+        int32_t format;
+        int32_t field;
+        int32_t symmetry;
+        int64_t nrows;
+        int64_t ncols;
+        int64_t vector_length;
+        int64_t nnz;
+        int64_t header_line_count;
+
+        uint64_t comment_offset;
+        uint64_t comment_length;
+        uint64_t rows_offset;
+        uint64_t cols_offset;
+        uint64_t values_offset;
+
+        // Number of stored elements
+        uint64_t length;
+    };
+
+    constexpr char kBinaryCacheMagic[8] = {'F', 'M', 'M', 'C', 'A', 'C', 'H', 'E'};
+    constexpr uint32_t kBinaryCacheByteOrder = 0x01020304;
+    constexpr uint32_t kBinaryCacheVersion = 1;
+    constexpr uint64_t kBinaryCacheAlignment = 64;
+
+    /**
+     * Write a binary cache of a body parsed into triplets.
+     *
+     * The file is written under a temporary name and renamed into place, so concurrent readers see either the old
+     * cache or the complete new one.
+     *
+     * @param rows, cols, values Iterators to `length` elements each.
+     * @return false if the cache could not be written, for example because the directory is read-only.
+     */
+    template <typename IT_ITER, typename VT_ITER>
+    bool write_binary_cache(const std::string& cache_path, const binary_cache_key& key,
+                            const matrix_market_header& header,
+                            IT_ITER rows, IT_ITER cols, VT_ITER values, uint64_t length) {
+        using IT = typename std::iterator_traits<IT_ITER>::value_type;
+        using VT = typename std::iterator_traits<VT_ITER>::value_type;
+
+        auto align = [](uint64_t offset) {
+            return (offset + kBinaryCacheAlignment - 1) / kBinaryCacheAlignment * kBinaryCacheAlignment;
+        };
+
+        binary_cache_file_header fh{};
+        std::memcpy(fh.magic, kBinaryCacheMagic, sizeof(fh.magic));
+        fh.byte_order = kBinaryCacheByteOrder;
+        fh.version = kBinaryCacheVersion;
+        fh.index_type = binary_cache_type_tag<IT>();
+        fh.value_type = binary_cache_type_tag<VT>();
+        fh.key = key;
+        fh.object = header.object;
+        fh.format = header.format;
+        fh.field = header.field;
+        fh.symmetry = header.symmetry;
+        fh.nrows = header.nrows;
+        fh.ncols = header.ncols;
+        fh.vector_length = header.vector_length;
+        fh.nnz = header.nnz;
+        fh.header_line_count = header.header_line_count;
+        fh.comment_offset = sizeof(fh);
+        fh.comment_length = header.comment.size();
+        fh.rows_offset = align(fh.comment_offset + fh.comment_length);
+        fh.cols_offset = align(fh.rows_offset + length * sizeof(IT));
+        fh.values_offset = align(fh.cols_offset + length * sizeof(IT));
+        fh.length = length;
+
+        std::random_device rd;
+        std::string tmp_path = cache_path + ".tmp" + std::to_string(rd());
+        {
+            std::ofstream f(tmp_path, std::ios_base::binary | std::ios_base::trunc);
+            if (!f) {
+                return false;
+            }
+
+            auto pad_to = [&](uint64_t offset) {
+                static const char zeros[kBinaryCacheAlignment] = {};
+                auto pos = static_cast<uint64_t>(f.tellp());
+                f.write(zeros, static_cast<std::streamsize>(offset - pos));
+            };
+
+            // Copy through a buffer so that any iterable works, not only contiguous storage.
+            auto write_array = [&](auto iter, auto* type) {
+                using T = std::remove_pointer_t<decltype(type)>;
+                std::vector<T> buffer;
+                buffer.reserve(std::min<uint64_t>(length, 1 << 16));
+                for (uint64_t written = 0; written < length;) {
+                    buffer.clear();
+                    for (; buffer.size() < buffer.capacity() && written < length; ++written, ++iter) {
+                        buffer.push_back(*iter);
+                    }
+                    f.write(reinterpret_cast<const char*>(buffer.data()), static_cast<std::streamsize>(buffer.size() * sizeof(T)));
+                }
+            };
+
+            f.write(reinterpret_cast<const char*>(&fh), sizeof(fh));
+            f.write(header.comment.data(), static_cast<std::streamsize>(header.comment.size()));
+            pad_to(fh.rows_offset);
+            write_array(rows, (IT*)nullptr);
+            pad_to(fh.cols_offset);
+            write_array(cols, (IT*)nullptr);
+            pad_to(fh.values_offset);
+            write_array(values, (VT*)nullptr);
+
+            f.close();
+            if (!f) {
+                std::error_code ec;
+                std::filesystem::remove(tmp_path, ec);
+                return false;
+            }
+        }
+
+        std::error_code ec;
+        std::filesystem::rename(tmp_path, cache_path, ec);
+        if (ec) {
+            std::filesystem::remove(tmp_path, ec);
+            return false;
+        }
+        return true;
+    }
+
+    /**
+     * A memory-mapped binary cache file.
+     *
+     * The arrays are used directly from the page cache, so loading a cached body costs one copy into the caller's
+     * vectors.
+     */
+    class mapped_binary_cache {
+    public:
+        explicit mapped_binary_cache(const std::string& cache_path) : file(cache_path) {
+            if (!file.is_mapped() || file.size() < sizeof(binary_cache_file_header)) {
+                return;
+            }
+            std::memcpy(&fh, file.begin(), sizeof(fh));
+            if (std::memcmp(fh.magic, kBinaryCacheMagic, sizeof(fh.magic)) != 0 ||
+                fh.byte_order != kBinaryCacheByteOrder || fh.version != kBinaryCacheVersion) {
+                return;
+            }
+            if (fh.comment_offset + fh.comment_length > file.size() || fh.values_offset > file.size()) {
+                return;
+            }
+            valid = true;
+        }
+
+        /**
+         * @return true if this is a complete cache of the source identified by `key`, stored with index type IT and
+         * value type VT.
+         */
+        template <typename IT, typename VT>
+        [[nodiscard]] bool matches(const binary_cache_key& key) const {
+            if (!valid || !(fh.key == key) ||
+                fh.index_type != binary_cache_type_tag<IT>() || fh.value_type != binary_cache_type_tag<VT>()) {
+                return false;
+            }
+            return fh.values_offset + fh.length * sizeof(VT) <= file.size();
+        }
+
+        [[nodiscard]] matrix_market_header get_header() const {
+            matrix_market_header header;
+            header.object = static_cast<object_type>(fh.object);
+            header.format = static_cast<format_type>(fh.format);
+            header.field = static_cast<field_type>(fh.field);
+            header.symmetry = static_cast<symmetry_type>(fh.symmetry);
+            header.nrows = fh.nrows;
+            header.ncols = fh.ncols;
+            header.vector_length = fh.vector_length;
+            header.nnz = fh.nnz;
+            header.header_line_count = fh.header_line_count;
+            header.comment.assign(file.begin() + fh.comment_offset, fh.comment_length);
+            return header;
+        }
+
+        [[nodiscard]] uint64_t length() const {
+            return fh.length;
+        }
+
+        template <typename IT>
+        [[nodiscard]] const IT* rows() const {
+            return reinterpret_cast<const IT*>(file.begin() + fh.rows_offset);
+        }
+
+        template <typename IT>
+        [[nodiscard]] const IT* cols() const {
+            return reinterpret_cast<const IT*>(file.begin() + fh.cols_offset);
+        }
+
+        template <typename VT>
+        [[nodiscard]] const VT* values() const {
+            return reinterpret_cast<const VT*>(file.begin() + fh.values_offset);
+        }
+
+    protected:
+        mapped_file file;
+        binary_cache_file_header fh{};
+        bool valid = false;
+    };
+
+    /**
+     * Copy an array out of a binary cache, in parallel for large arrays.
+     */
+    template <typename T, typename ITER>
+    void copy_binary_cache_array(const T* src, uint64_t length, ITER dest, const read_options& options) {
+        constexpr uint64_t kMinParallelLength = 1 << 20;
+        if (!options.parallel_ok || options.num_threads == 1 || length < kMinParallelLength) {
+            std::copy(src, src + length, dest);
+            return;
+        }
+
+        scoped_thread_pool pool(options);
+        auto num_ranges = static_cast<uint64_t>(pool.get_num_threads());
+        std::vector<std::future<void>> futures;
+        for (uint64_t range = 0; range < num_ranges; ++range) {
+            auto begin = length * range / num_ranges;
+            auto end = length * (range + 1) / num_ranges;
+            futures.push_back(pool.submit([=] {
+                std::copy(src + begin, src + end, dest + (std::ptrdiff_t)begin);
+            }));
+        }
+        for (auto& future : futures) {
+            future.get();
+        }
+    }
+}
@@ -0,0 +1,153 @@
+// Copyright (C) 2023 Adam Lugowski. All rights reserved.
+// Use of this source code is governed by the BSD 2-clause license found in the LICENSE.txt file.
+// SPDX-License-Identifier: BSD-2-Clause
+
+#pragma once
+
+#include <algorithm>
+#include <cstdint>
+#include <mutex>
+#include <string>
+#include <vector>
+
+#if defined(__linux__)
+#include <sys/mman.h>
+#include <unistd.h>
+#if defined(MADV_HUGEPAGE)
+#define FMM_HAVE_MADV_HUGEPAGE 1
+#endif
+#endif
+
+namespace fast_matrix_market {
+
+    /**
+     * A pool of chunk buffers that the read and write pipelines draw from instead of allocating.
+     * See read_options::buffer_pool.
+     *
+     * Share one pool between calls so that steady-state reads and writes make no large allocations.
+     *
+     * Thread safe.
+     */
+    class chunk_buffer_pool {
+    public:
+        /**
+         * @param max_idle_buffers number of unused buffers to keep. Buffers released beyond that are freed.
+         * @param huge_pages advise the kernel to back new buffers with transparent huge pages. Linux only.
+         */
+        explicit chunk_buffer_pool(std::size_t max_idle_buffers = 64, bool huge_pages = false) :
+            max_idle_buffers(max_idle_buffers), huge_pages(huge_pages) {}
+
+        /**
+         * @return an empty buffer with at least `min_capacity` capacity. Reuses an idle buffer if there is one.
+         */
+        std::string acquire(std::size_t min_capacity = 0) {
+            std::string buffer;
+            {
+                std::lock_guard<std::mutex> lock(mutex);
+                if (idle.empty()) {
+                    ++num_misses;
+                } else {
+                    buffer = std::move(idle.back());
+                    idle.pop_back();
+                }
+            }
+
+            buffer.clear();
+            if (buffer.capacity() < min_capacity) {
+                buffer.reserve(min_capacity);
+                advise(buffer);
+            }
+            return buffer;
+        }
+
+        /**
+         * Return a buffer to the pool. Small buffers are freed.
+         */
+        void release(std::string&& buffer) {
+            if (buffer.capacity() < kMinPooledCapacity) {
+                return;
+            }
+            std::lock_guard<std::mutex> lock(mutex);
+            if (idle.size() < max_idle_buffers) {
+                idle.push_back(std::move(buffer));
+            }
+        }
+
+        /**
+         * @return number of acquire() calls that found no idle buffer.
+         */
+        [[nodiscard]] int64_t get_num_misses() const {
+            std::lock_guard<std::mutex> lock(mutex);
+            return num_misses;
+        }
+
+        [[nodiscard]] std::size_t get_num_idle() const {
+            std::lock_guard<std::mutex> lock(mutex);
+            return idle.size();
+        }
+
+        /**
+         * Free all idle buffers.
+         */
+        void clear() {
+            std::lock_guard<std::mutex> lock(mutex);
+            idle.clear();
+        }
+
+        static constexpr std::size_t kMinPooledCapacity = 4096;
+
+    protected:
+        void advise([[maybe_unused]] std::string& buffer) const {
+#ifdef FMM_HAVE_MADV_HUGEPAGE
+            if (!huge_pages) {
+                return;
+            }
+            // Only whole pages inside the buffer can be advised.
+            const auto page = static_cast<uintptr_t>(sysconf(_SC_PAGESIZE));
+            auto begin = (reinterpret_cast<uintptr_t>(buffer.data()) + page - 1) / page * page;
+            auto end = (reinterpret_cast<uintptr_t>(buffer.data()) + buffer.capacity()) / page * page;
+            if (begin < end) {
+                // Only a hint. Failure leaves regular pages.
+                madvise(reinterpret_cast<void*>(begin), end - begin, MADV_HUGEPAGE);
+            }
+#endif
+        }
+
+        mutable std::mutex mutex;
+        std::vector<std::string> idle;
+        std::size_t max_idle_buffers;
+        bool huge_pages;
+        int64_t num_misses = 0;
+    };
+
+    /**
+     * The pool that chunk_output draws its buffer from on this thread, or nullptr.
+     *
+     * Formatters build their chunks with chunk_output, so the write pipelines set this around each chunk instead of
+     * passing the pool through every formatter.
+     */
+    inline chunk_buffer_pool*& current_chunk_buffer_pool() {
+        thread_local chunk_buffer_pool* pool = nullptr;
+        return pool;
+    }
+
+    /**
+     * Sets current_chunk_buffer_pool() for the lifetime of this object.
+     */
+    class scoped_chunk_buffer_pool {
+    public:
+        explicit scoped_chunk_buffer_pool(chunk_buffer_pool* pool) : previous(current_chunk_buffer_pool()) {
+            current_chunk_buffer_pool() = pool;
+        }
+
+        ~scoped_chunk_buffer_pool() {
+            current_chunk_buffer_pool() = previous;
+        }
+
+        scoped_chunk_buffer_pool(const scoped_chunk_buffer_pool&) = delete;
+        scoped_chunk_buffer_pool& operator=(const scoped_chunk_buffer_pool&) = delete;
+
+    protected:
+        chunk_buffer_pool* previous;
+    };
+}
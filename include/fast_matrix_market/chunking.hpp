@@ -4,10 +4,75 @@
 
 #pragma once
 
+#include <algorithm>
+#include <cstring>
 #include <istream>
+#include <streambuf>
 #include <string>
+#include <string_view>
+
+#include "simd.hpp"
 
 namespace fast_matrix_market {
+    /**
+     * A read-only streambuf over a contiguous block of memory, such as a memory-mapped file.
+     *
+     * The body readers recognize this streambuf and parse chunks directly out of the underlying memory instead of
+     * copying them out of the stream. The header is still read through the regular std::istream interface.
+     */
+    class memory_streambuf : public std::streambuf {
+    public:
+        memory_streambuf() = default;
+        memory_streambuf(const char* begin, const char* end) {
+            set_range(begin, end);
+        }
+
+        void set_range(const char* begin, const char* end) {
+            // std::streambuf requires non-const pointers, but a get area is never written to.
+            setg(const_cast<char*>(begin), const_cast<char*>(begin), const_cast<char*>(end));
+        }
+
+        /**
+         * @return the bytes that have not been read yet.
+         */
+        [[nodiscard]] std::string_view remaining() const {
+            return {gptr(), static_cast<std::size_t>(egptr() - gptr())};
+        }
+
+        /**
+         * Mark the next `n` bytes as read.
+         */
+        void consume(std::size_t n) {
+            setg(eback(), gptr() + n, egptr());
+        }
+
+    protected:
+        pos_type seekoff(off_type off, std::ios_base::seekdir dir, std::ios_base::openmode which) override {
+            if ((which & std::ios_base::in) == 0) {
+                return pos_type(off_type(-1));
+            }
+
+            off_type base;
+            switch (dir) {
+                case std::ios_base::beg: base = 0; break;
+                case std::ios_base::cur: base = gptr() - eback(); break;
+                case std::ios_base::end: base = egptr() - eback(); break;
+                default: return pos_type(off_type(-1));
+            }
+
+            off_type target = base + off;
+            if (target < 0 || target > egptr() - eback()) {
+                return pos_type(off_type(-1));
+            }
+            setg(eback(), eback() + target, egptr());
+            return pos_type(target);
+        }
+
+        pos_type seekpos(pos_type pos, std::ios_base::openmode which) override {
+            return seekoff(off_type(pos), std::ios_base::beg, which);
+        }
+    };
+
     inline void get_next_chunk(std::string& chunk, std::istream &instream, const read_options &options) {
         constexpr size_t chunk_extra = 4096; // extra chunk bytes to leave room for rest of line
         size_t chunk_length = 0;
@@ -55,6 +120,133 @@ namespace fast_matrix_market {
         return chunk;
     }
 
+    /**
+     * Get the next chunk out of a memory buffer. The chunk points into the buffer's memory, no copy is made.
+     *
+     * The exception is the final chunk. The parsers expect the byte after a chunk to be readable and to terminate
+     * the last line, so the final chunk is copied into `buffer` which supplies a terminating null.
+     */
+    inline std::string_view get_next_chunk(std::string& buffer, memory_streambuf& membuf, const read_options &options) {
+        std::string_view rest = membuf.remaining();
+
+        // find the end of the line that contains the chunk_size_bytes-th byte
+        auto target = static_cast<std::size_t>(std::max(options.chunk_size_bytes, (int64_t)1));
+        std::size_t chunk_length = rest.size();
+        if (target < rest.size()) {
+            auto newline_pos = rest.find('\n', target - 1);
+            if (newline_pos != std::string_view::npos) {
+                chunk_length = newline_pos + 1;
+            }
+        }
+
+        membuf.consume(chunk_length);
+
+        if (chunk_length == rest.size()) {
+            buffer.assign(rest);
+            return buffer;
+        }
+        return rest.substr(0, chunk_length);
+    }
+
+    /**
+     * Snap a byte offset to a line boundary.
+     *
+     * @return the offset of the first byte after the line that contains byte `offset - 1`, or `body.size()`.
+     */
+    inline std::size_t snap_to_line_start(std::string_view body, std::size_t offset) {
+        if (offset == 0) {
+            return 0;
+        }
+        if (offset >= body.size()) {
+            return body.size();
+        }
+        auto newline_pos = body.find('\n', offset - 1);
+        return newline_pos == std::string_view::npos ? body.size() : newline_pos + 1;
+    }
+
+    /**
+     * Get the `range_index`-th chunk of a memory buffer that has been split into `chunk_size`-byte ranges.
+     *
+     * Each range is snapped to line boundaries the same way get_next_chunk() snaps its chunks, so the ranges can
+     * be found independently and in parallel. Ranges may be empty if a line spans several of them.
+     *
+     * As with get_next_chunk(), the range that ends the buffer is copied into `buffer` to supply a terminating null.
+     */
+    inline std::string_view get_range_chunk(std::string& buffer, std::string_view body,
+                                            std::size_t range_index, std::size_t chunk_size) {
+        std::size_t begin = snap_to_line_start(body, range_index * chunk_size);
+        std::size_t end = snap_to_line_start(body, (range_index + 1) * chunk_size);
+
+        if (begin < end && end == body.size()) {
+            buffer.assign(body.substr(begin));
+            return buffer;
+        }
+        return body.substr(begin, end - begin);
+    }
+
+    /**
+     * Reads body chunks from a stream.
+     *
+     * If the stream is backed by a memory_streambuf then chunks are views into that memory. Otherwise chunks
+     * are read out of the stream into a caller-provided buffer.
+     */
+    class chunk_reader {
+    public:
+        chunk_reader(std::istream& instream, const read_options& options) :
+                instream(instream), options(options), membuf(dynamic_cast<memory_streambuf*>(instream.rdbuf())) {}
+
+        /**
+         * @return true if there may be more chunks to read.
+         */
+        [[nodiscard]] bool has_next() const {
+            if (membuf != nullptr) {
+                return instream.good() && !membuf->remaining().empty();
+            }
+            return instream.good();
+        }
+
+        /**
+         * @return true if the stream is backed by a memory_streambuf, so chunks can be found without reading.
+         */
+        [[nodiscard]] bool is_memory_backed() const {
+            return membuf != nullptr;
+        }
+
+        /**
+         * Take all remaining bytes of a memory-backed stream at once. See is_memory_backed().
+         *
+         * @return a view of the remaining bytes. Callers must use get_range_chunk() to find chunks within it.
+         */
+        std::string_view take_remaining() {
+            if (!instream.good()) {
+                return {};
+            }
+            std::string_view rest = membuf->remaining();
+            membuf->consume(rest.size());
+            return rest;
+        }
+
+        /**
+         * Read the next chunk.
+         *
+         * @param buffer storage that may back the returned view. Must outlive the use of the returned view.
+         * @return the chunk
+         */
+        std::string_view next_chunk(std::string& buffer) {
+            if (membuf != nullptr) {
+                return get_next_chunk(buffer, *membuf, options);
+            }
+
+            get_next_chunk(buffer, instream, options);
+            return buffer;
+        }
+
+    protected:
+        std::istream& instream;
+        const read_options& options;
+        memory_streambuf* membuf;
+    };
+
     template <typename ITER>
     bool is_all_spaces(ITER begin, ITER end) {
         return std::all_of(begin, end, [](char c) { return c == ' ' || c == '\t' || c == '\r'; });
@@ -62,8 +254,10 @@ namespace fast_matrix_market {
 
     /**
      * Find the number of total lines and empty lines in a multiline string.
+     *
+     * Portable byte-at-a-time version. See count_lines().
      */
-    inline std::pair<int64_t, int64_t> count_lines(const std::string& chunk) {
+    inline std::pair<int64_t, int64_t> count_lines_scalar(std::string_view chunk) {
         int64_t num_newlines = 0;
         int64_t num_empty_lines = 0;
 
@@ -101,4 +295,134 @@ namespace fast_matrix_market {
 
         return std::make_pair(num_newlines, num_empty_lines);
     }
+
+    namespace simd {
+        /**
+         * Running state of a vectorized line count.
+         */
+        struct line_count_state {
+            int64_t num_newlines = 0;
+            int64_t num_empty_lines = 0;
+
+            /**
+             * Whether the current, not yet terminated, line has any non-whitespace characters.
+             */
+            bool line_has_content = false;
+        };
+
+        /**
+         * Count the lines terminated within one 64-byte block.
+         */
+        inline void count_lines_block(line_count_state& state, block_masks masks) {
+            uint64_t newline = masks.newline;
+            uint64_t content = masks.content;
+            while (newline != 0) {
+                uint64_t lowest = newline & (~newline + 1);
+                uint64_t before = lowest - 1;
+
+                ++state.num_newlines;
+                if (!state.line_has_content && (content & before) == 0) {
+                    ++state.num_empty_lines;
+                }
+                state.line_has_content = false;
+
+                content &= ~before;
+                newline ^= lowest;
+            }
+
+            if (content != 0) {
+                state.line_has_content = true;
+            }
+        }
+
+        /**
+         * Count lines 64 bytes at a time using the CLASSIFY kernel to build the block bitmasks.
+         */
+        template <block_masks (*CLASSIFY)(const char*)>
+        std::pair<int64_t, int64_t> count_lines_blocks(std::string_view chunk) {
+            constexpr std::size_t block_size = 64;
+            line_count_state state;
+
+            const char* pos = chunk.data();
+            const char* end = chunk.data() + chunk.size();
+            for (; end - pos >= (std::ptrdiff_t)block_size; pos += block_size) {
+                count_lines_block(state, CLASSIFY(pos));
+            }
+
+            if (pos != end) {
+                // pad the final partial block with whitespace
+                char block[block_size];
+                std::memset(block, ' ', block_size);
+                std::memcpy(block, pos, end - pos);
+                count_lines_block(state, CLASSIFY(block));
+            }
+
+            if (!chunk.empty() && chunk.back() != '\n') {
+                // last line does not end in newline, but it might still be empty
+                if (!state.line_has_content) {
+                    ++state.num_empty_lines;
+                }
+            }
+
+            if (state.num_newlines == 0) {
+                // single line is still a line
+                return std::make_pair(1, chunk.empty() ? 1 : state.num_empty_lines);
+            }
+
+            if (chunk.back() != '\n') {
+                ++state.num_newlines;
+            }
+
+            return std::make_pair(state.num_newlines, state.num_empty_lines);
+        }
+
+#ifdef FMM_SIMD_SSE2
+        inline std::pair<int64_t, int64_t> count_lines_sse2(std::string_view chunk) {
+            return count_lines_blocks<classify_block_sse2>(chunk);
+        }
+#endif
+
+#ifdef FMM_SIMD_AVX2
+        FMM_SIMD_AVX2_TARGET inline std::pair<int64_t, int64_t> count_lines_avx2(std::string_view chunk) {
+            return count_lines_blocks<classify_block_avx2>(chunk);
+        }
+#endif
+
+#ifdef FMM_SIMD_NEON
+        inline std::pair<int64_t, int64_t> count_lines_neon(std::string_view chunk) {
+            return count_lines_blocks<classify_block_neon>(chunk);
+        }
+#endif
+
+        using count_lines_kernel = std::pair<int64_t, int64_t> (*)(std::string_view);
+
+        /**
+         * @return the fastest line count kernel supported by this CPU.
+         */
+        inline count_lines_kernel select_count_lines_kernel() {
+#ifdef FMM_SIMD_AVX2
+            if (cpu_has_avx2()) {
+                return count_lines_avx2;
+            }
+#endif
+#if defined(FMM_SIMD_SSE2)
+            return count_lines_sse2;
+#elif defined(FMM_SIMD_NEON)
+            return count_lines_neon;
+#else
+            return count_lines_scalar;
+#endif
+        }
+    }
+
+    /**
+     * Find the number of total lines and empty lines in a multiline string.
+     *
+     * Lines that contain only whitespace are considered empty.
+     * Uses a SIMD kernel selected at runtime if one is available, see simd.hpp.
+     */
+    inline std::pair<int64_t, int64_t> count_lines(std::string_view chunk) {
+        static const simd::count_lines_kernel kernel = simd::select_count_lines_kernel();
+        return kernel(chunk);
+    }
 }
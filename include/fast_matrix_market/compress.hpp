@@ -0,0 +1,240 @@
+// Copyright (C) 2023 Adam Lugowski. All rights reserved.
+// Use of this source code is governed by the BSD 2-clause license found in the LICENSE.txt file.
+// SPDX-License-Identifier: BSD-2-Clause
+
+#pragma once
+
+#include <ostream>
+#include <string>
+#include <vector>
+
+#include "decompress.hpp"
+
+namespace fast_matrix_market {
+
+    /**
+     * @return true if this build can write `compression` with compress_ostream.
+     */
+    inline bool is_compression_supported(compression_type compression) {
+        switch (compression) {
+            case NoCompression: return true;
+#ifdef FMM_USE_ZLIB
+            case GzipCompression: return true;
+#endif
+#ifdef FMM_USE_ZSTD
+            case ZstdCompression: return true;
+#endif
+            default: return false;
+        }
+    }
+
+#ifdef FMM_USE_ZLIB
+    /**
+     * Compress data as one complete gzip member.
+     *
+     * The member's extra field records the member's size, so find_gzip_blocks() can split a file of such members
+     * without decompressing it. Any other gzip reader sees an ordinary multi-member file.
+     */
+    inline std::string gzip_compress_block(const char* data, std::size_t size, int level) {
+        z_stream zs{};
+        // 15 + 16: maximum window size, gzip wrapper.
+        if (deflateInit2(&zs, level, Z_DEFLATED, 15 + 16, 8, Z_DEFAULT_STRATEGY) != Z_OK) {
+            throw fmm_error("Cannot initialize zlib.");
+        }
+
+        // Subfield ID, 2-byte length, then the member size which is filled in below.
+        unsigned char extra[8] = {(unsigned char)kGzipBlockSizeSubfield[0], (unsigned char)kGzipBlockSizeSubfield[1],
+                                  4, 0, 0, 0, 0, 0};
+        gz_header header{};
+        header.extra = extra;
+        header.extra_len = sizeof(extra);
+        header.os = 255; // unknown
+        deflateSetHeader(&zs, &header);
+
+        std::string compressed(deflateBound(&zs, static_cast<uLong>(size)) + sizeof(extra), '\0');
+        zs.next_in = reinterpret_cast<Bytef*>(const_cast<char*>(data));
+        zs.avail_in = static_cast<uInt>(size);
+        zs.next_out = reinterpret_cast<Bytef*>(compressed.data());
+        zs.avail_out = static_cast<uInt>(compressed.size());
+        int ret = deflate(&zs, Z_FINISH);
+        compressed.resize(zs.total_out);
+        deflateEnd(&zs);
+        if (ret != Z_STREAM_END) {
+            throw fmm_error("Error compressing gzip output.");
+        }
+
+        // 10-byte fixed header, 2-byte XLEN, 4-byte subfield header.
+        auto member_size = static_cast<uint32_t>(compressed.size());
+        for (int i = 0; i < 4; ++i) {
+            compressed[16 + i] = static_cast<char>((member_size >> (8 * i)) & 0xff);
+        }
+        return compressed;
+    }
+#endif
+
+#ifdef FMM_USE_ZSTD
+    /**
+     * Compress data as one zstd frame. The frame records its decompressed size.
+     */
+    inline std::string zstd_compress_block(const char* data, std::size_t size, int level) {
+        std::string compressed(ZSTD_compressBound(size), '\0');
+        std::size_t ret = ZSTD_compress(compressed.data(), compressed.size(), data, size,
+                                        level < 0 ? ZSTD_CLEVEL_DEFAULT : level);
+        if (ZSTD_isError(ret)) {
+            throw fmm_error(std::string("Error compressing zstd output: ") + ZSTD_getErrorName(ret));
+        }
+        compressed.resize(ret);
+        return compressed;
+    }
+#endif
+
+    /**
+     * Compress data as one block that decompresses on its own. Thread safe.
+     *
+     * @param level compression level, or -1 for the format's default.
+     */
+    inline std::string compress_block(compression_type compression, const char* data, std::size_t size, int level = -1) {
+        switch (compression) {
+            case NoCompression: return std::string(data, size);
+#ifdef FMM_USE_ZLIB
+            case GzipCompression: return gzip_compress_block(data, size, level);
+#endif
+#ifdef FMM_USE_ZSTD
+            case ZstdCompression: return zstd_compress_block(data, size, level);
+#endif
+            default:
+                throw invalid_argument("This build of fast_matrix_market cannot write " +
+                                       compression_name(compression) + "-compressed output.");
+        }
+    }
+
+    /**
+     * A write-only streambuf that compresses its output as a sequence of independent blocks.
+     *
+     * Each block is a zstd frame or a gzip member that records its own size, so the output is a regular zstd or
+     * gzip file that decompress_streambuf can also decompress in parallel.
+     *
+     * Sequential writes are buffered and compressed in blocks of up to kBlockSize bytes. The parallel writer
+     * instead has each worker compress its own body chunk with compress(), then writes the blocks in order with
+     * write_block().
+     */
+    class compress_streambuf : public std::streambuf {
+    public:
+        static constexpr std::size_t kBlockSize = 1 << 20;
+
+        /**
+         * @param target where compressed blocks are written.
+         * @param level compression level, or -1 for the format's default.
+         */
+        compress_streambuf(std::streambuf* target, compression_type compression, int level = -1) :
+                target(target), compression(compression), level(level), buffer(kBlockSize) {
+            if (!is_compression_supported(compression)) {
+                throw invalid_argument("This build of fast_matrix_market cannot write " +
+                                       compression_name(compression) + "-compressed output.");
+            }
+            setp(buffer.data(), buffer.data() + buffer.size());
+        }
+
+        ~compress_streambuf() override {
+            sync();
+        }
+
+        compress_streambuf(const compress_streambuf&) = delete;
+        compress_streambuf& operator=(const compress_streambuf&) = delete;
+
+        [[nodiscard]] compression_type get_compression() const {
+            return compression;
+        }
+
+        /**
+         * Compress one block. Does not write anything. Thread safe.
+         */
+        [[nodiscard]] std::string compress(const std::string& data) const {
+            return compress_block(compression, data.data(), data.size(), level);
+        }
+
+        /**
+         * Write a block returned by compress(). Anything buffered is written as a block before it.
+         */
+        void write_block(const std::string& compressed) {
+            if (!flush_buffer()) {
+                throw fmm_error("Error writing compressed output.");
+            }
+            write_target(compressed);
+        }
+
+    protected:
+        int_type overflow(int_type ch) override {
+            if (!flush_buffer()) {
+                return traits_type::eof();
+            }
+            if (!traits_type::eq_int_type(ch, traits_type::eof())) {
+                *pptr() = traits_type::to_char_type(ch);
+                pbump(1);
+            }
+            return traits_type::not_eof(ch);
+        }
+
+        int sync() override {
+            if (!flush_buffer()) {
+                return -1;
+            }
+            return target->pubsync();
+        }
+
+        /**
+         * Compress and write anything buffered as one block.
+         */
+        bool flush_buffer() {
+            auto size = static_cast<std::size_t>(pptr() - pbase());
+            if (size > 0) {
+                try {
+                    write_target(compress_block(compression, pbase(), size, level));
+                } catch (const fmm_error&) {
+                    return false;
+                }
+                setp(buffer.data(), buffer.data() + buffer.size());
+            }
+            return true;
+        }
+
+        void write_target(const std::string& compressed) {
+            auto size = static_cast<std::streamsize>(compressed.size());
+            if (target->sputn(compressed.data(), size) != size) {
+                throw fmm_error("Error writing compressed output.");
+            }
+        }
+
+        std::streambuf* target;
+        compression_type compression;
+        int level;
+        std::vector<char> buffer;
+    };
+
+    /**
+     * An output stream that writes block-compressed gzip or zstd. See compress_streambuf.
+     *
+     * Wrap any std::ostream, then pass this to any write_matrix_market_* method:
+     * @code
+     * std::ofstream f("matrix.mtx.zst", std::ios_base::binary);
+     * fast_matrix_market::compress_ostream compressed(f, fast_matrix_market::ZstdCompression);
+     * fast_matrix_market::write_matrix_market_triplet(compressed, ...);
+     * @endcode
+     *
+     * The parallel writer compresses each body chunk on the worker that formatted it. Output is complete once this
+     * stream is flushed or destroyed.
+     */
+    class compress_ostream : public std::ostream {
+    public:
+        /**
+         * @param level compression level, or -1 for the format's default.
+         */
+        compress_ostream(std::ostream& target, compression_type compression, int level = -1) :
+                std::ostream(nullptr), buf(target.rdbuf(), compression, level) {
+            rdbuf(&buf);
+        }
+
+    protected:
+        compress_streambuf buf;
+    };
+}
@@ -0,0 +1,626 @@
+// Copyright (C) 2023 Adam Lugowski. All rights reserved.
+// Use of this source code is governed by the BSD 2-clause license found in the LICENSE.txt file.
+// SPDX-License-Identifier: BSD-2-Clause
+
+#pragma once
+
+#include <algorithm>
+#include <climits>
+#include <deque>
+#include <future>
+#include <memory>
+#include <string>
+#include <string_view>
+#include <vector>
+
+#ifdef FMM_USE_ZLIB
+#include <zlib.h>
+#endif
+
+#ifdef FMM_USE_BZIP2
+#include <bzlib.h>
+#endif
+
+#ifdef FMM_USE_ZSTD
+#include <zstd.h>
+#endif
+
+#include "fast_matrix_market.hpp"
+#include "thread_pool.hpp"
+
+namespace fast_matrix_market {
+
+    enum compression_type {NoCompression, GzipCompression, Bzip2Compression, ZstdCompression};
+
+    /**
+     * Identify a compressed input by its magic bytes.
+     *
+     * A Matrix Market file is text, so none of these can be the start of an uncompressed file.
+     */
+    inline compression_type detect_compression(const char* data, std::size_t size) {
+        auto bytes = reinterpret_cast<const unsigned char*>(data);
+        if (size >= 2 && bytes[0] == 0x1f && bytes[1] == 0x8b) {
+            return GzipCompression;
+        }
+        if (size >= 3 && bytes[0] == 'B' && bytes[1] == 'Z' && bytes[2] == 'h') {
+            return Bzip2Compression;
+        }
+        if (size >= 4 && bytes[0] == 0x28 && bytes[1] == 0xb5 && bytes[2] == 0x2f && bytes[3] == 0xfd) {
+            return ZstdCompression;
+        }
+        return NoCompression;
+    }
+
+    /**
+     * @return true if this build can decompress `compression`.
+     */
+    inline bool is_decompression_supported(compression_type compression) {
+        switch (compression) {
+            case NoCompression: return true;
+#ifdef FMM_USE_ZLIB
+            case GzipCompression: return true;
+#endif
+#ifdef FMM_USE_BZIP2
+            case Bzip2Compression: return true;
+#endif
+#ifdef FMM_USE_ZSTD
+            case ZstdCompression: return true;
+#endif
+            default: return false;
+        }
+    }
+
+    inline std::string compression_name(compression_type compression) {
+        switch (compression) {
+            case GzipCompression: return "gzip";
+            case Bzip2Compression: return "bzip2";
+            case ZstdCompression: return "zstd";
+            default: return "uncompressed";
+        }
+    }
+
+    /**
+     * Incremental decoder of one compression format.
+     */
+    class decoder {
+    public:
+        virtual ~decoder() = default;
+
+        /**
+         * Decompress from [in, in_end) into out.
+         *
+         * @param in advanced past the consumed input.
+         * @return number of bytes written to out.
+         */
+        virtual std::size_t decode(const char*& in, const char* in_end, char* out, std::size_t out_size) = 0;
+
+        /**
+         * @return true if the input consumed so far ends on a complete compressed stream.
+         */
+        [[nodiscard]] virtual bool at_stream_end() const = 0;
+    };
+
+    /**
+     * A part of a compressed input that decompresses on its own to a known size.
+     */
+    struct compressed_block {
+        std::string_view data;
+        std::size_t decompressed_size;
+    };
+
+    /**
+     * Gzip extra subfield that records the size of the member it is in, similar to BGZF's BC subfield.
+     * Subfield data is the whole member's size in bytes as a 32-bit little-endian integer.
+     */
+    constexpr char kGzipBlockSizeSubfield[2] = {'F', 'M'};
+
+    /**
+     * Find the members of a gzip input, such as written by compress_ostream, that record their own size.
+     *
+     * @return the members, or empty if any member does not record its size.
+     */
+    inline std::vector<compressed_block> find_gzip_blocks(const char* begin, const char* end) {
+        auto read_le = [](const char* p, int num_bytes) {
+            std::size_t value = 0;
+            for (int i = num_bytes - 1; i >= 0; --i) {
+                value = (value << 8) | static_cast<unsigned char>(p[i]);
+            }
+            return value;
+        };
+
+        // Fixed header, XLEN, and the 8-byte CRC32 and ISIZE trailer.
+        constexpr std::size_t kMinMemberSize = 10 + 2 + 8;
+        constexpr unsigned char kFlagExtra = 0x04;
+
+        std::vector<compressed_block> blocks;
+        while (begin < end) {
+            auto remaining = static_cast<std::size_t>(end - begin);
+            if (remaining < kMinMemberSize || detect_compression(begin, remaining) != GzipCompression ||
+                (static_cast<unsigned char>(begin[3]) & kFlagExtra) == 0) {
+                return {};
+            }
+
+            std::size_t member_size = 0;
+            const char* extra = begin + 12;
+            const char* extra_end = extra + read_le(begin + 10, 2);
+            if (extra_end > end) {
+                return {};
+            }
+            while (extra + 4 <= extra_end) {
+                std::size_t len = read_le(extra + 2, 2);
+                if (extra[0] == kGzipBlockSizeSubfield[0] && extra[1] == kGzipBlockSizeSubfield[1] && len == 4 &&
+                    extra + 8 <= extra_end) {
+                    member_size = read_le(extra + 4, 4);
+                    break;
+                }
+                extra += 4 + len;
+            }
+            if (member_size < kMinMemberSize || member_size > remaining) {
+                return {};
+            }
+
+            // The ISIZE trailer is the decompressed size modulo 2^32. Blocks are far smaller than that.
+            blocks.push_back({std::string_view(begin, member_size), read_le(begin + member_size - 4, 4)});
+            begin += member_size;
+        }
+        return blocks;
+    }
+
+#ifdef FMM_USE_ZLIB
+    /**
+     * Decodes gzip, including concatenated members such as written by pigz or bgzip.
+     */
+    class gzip_decoder : public decoder {
+    public:
+        gzip_decoder() {
+            // 15 + 32: maximum window size, detect gzip or zlib wrapper.
+            if (inflateInit2(&zs, 15 + 32) != Z_OK) {
+                throw fmm_error("Cannot initialize zlib.");
+            }
+        }
+
+        ~gzip_decoder() override {
+            inflateEnd(&zs);
+        }
+
+        std::size_t decode(const char*& in, const char* in_end, char* out, std::size_t out_size) override {
+            if (stream_end) {
+                if (in == in_end) {
+                    return 0;
+                }
+                // Next member
+                inflateReset(&zs);
+                stream_end = false;
+            }
+
+            zs.next_in = reinterpret_cast<Bytef*>(const_cast<char*>(in));
+            zs.avail_in = static_cast<uInt>(std::min<std::size_t>(in_end - in, UINT_MAX));
+            zs.next_out = reinterpret_cast<Bytef*>(out);
+            zs.avail_out = static_cast<uInt>(std::min<std::size_t>(out_size, UINT_MAX));
+
+            int ret = inflate(&zs, Z_NO_FLUSH);
+            if (ret == Z_STREAM_END) {
+                stream_end = true;
+            } else if (ret != Z_OK && ret != Z_BUF_ERROR) {
+                throw fmm_error(std::string("Error decompressing gzip input: ") + (zs.msg != nullptr ? zs.msg : "unknown error"));
+            }
+
+            in = reinterpret_cast<const char*>(zs.next_in);
+            return static_cast<std::size_t>(reinterpret_cast<char*>(zs.next_out) - out);
+        }
+
+        [[nodiscard]] bool at_stream_end() const override {
+            return stream_end;
+        }
+
+    protected:
+        z_stream zs{};
+        bool stream_end = false;
+    };
+#endif
+
+#ifdef FMM_USE_BZIP2
+    /**
+     * Decodes bzip2, including concatenated streams such as written by pbzip2.
+     */
+    class bzip2_decoder : public decoder {
+    public:
+        bzip2_decoder() {
+            init();
+        }
+
+        ~bzip2_decoder() override {
+            BZ2_bzDecompressEnd(&bs);
+        }
+
+        std::size_t decode(const char*& in, const char* in_end, char* out, std::size_t out_size) override {
+            if (stream_end) {
+                if (in == in_end) {
+                    return 0;
+                }
+                // Next stream
+                BZ2_bzDecompressEnd(&bs);
+                init();
+            }
+
+            bs.next_in = const_cast<char*>(in);
+            bs.avail_in = static_cast<unsigned int>(std::min<std::size_t>(in_end - in, UINT_MAX));
+            bs.next_out = out;
+            bs.avail_out = static_cast<unsigned int>(std::min<std::size_t>(out_size, UINT_MAX));
+
+            int ret = BZ2_bzDecompress(&bs);
+            if (ret == BZ_STREAM_END) {
+                stream_end = true;
+            } else if (ret != BZ_OK) {
+                throw fmm_error("Error decompressing bzip2 input: code " + std::to_string(ret));
+            }
+
+            in = bs.next_in;
+            return static_cast<std::size_t>(bs.next_out - out);
+        }
+
+        [[nodiscard]] bool at_stream_end() const override {
+            return stream_end;
+        }
+
+    protected:
+        void init() {
+            bs = bz_stream{};
+            if (BZ2_bzDecompressInit(&bs, 0, 0) != BZ_OK) {
+                throw fmm_error("Cannot initialize bzip2.");
+            }
+            stream_end = false;
+        }
+
+        bz_stream bs{};
+        bool stream_end = false;
+    };
+#endif
+
+#ifdef FMM_USE_ZSTD
+    /**
+     * Decodes zstd. Concatenated frames are decoded one after the other.
+     */
+    class zstd_decoder : public decoder {
+    public:
+        zstd_decoder() : ctx(ZSTD_createDCtx()) {
+            if (ctx == nullptr) {
+                throw fmm_error("Cannot initialize zstd.");
+            }
+        }
+
+        ~zstd_decoder() override {
+            ZSTD_freeDCtx(ctx);
+        }
+
+        std::size_t decode(const char*& in, const char* in_end, char* out, std::size_t out_size) override {
+            if (frame_end && in == in_end) {
+                return 0;
+            }
+
+            ZSTD_inBuffer input{in, static_cast<std::size_t>(in_end - in), 0};
+            ZSTD_outBuffer output{out, out_size, 0};
+
+            std::size_t ret = ZSTD_decompressStream(ctx, &output, &input);
+            if (ZSTD_isError(ret)) {
+                throw fmm_error(std::string("Error decompressing zstd input: ") + ZSTD_getErrorName(ret));
+            }
+            frame_end = (ret == 0);
+
+            in += input.pos;
+            return output.pos;
+        }
+
+        [[nodiscard]] bool at_stream_end() const override {
+            return frame_end;
+        }
+
+    protected:
+        ZSTD_DCtx* ctx;
+        bool frame_end = false;
+    };
+
+    /**
+     * Find the frames of a zstd input that can each be decompressed on their own, such as written by pzstd.
+     *
+     * @return the frames, or empty if any frame does not record its decompressed size.
+     */
+    inline std::vector<compressed_block> find_zstd_blocks(const char* begin, const char* end) {
+        std::vector<compressed_block> blocks;
+        while (begin < end) {
+            auto remaining = static_cast<std::size_t>(end - begin);
+            std::size_t compressed_size = ZSTD_findFrameCompressedSize(begin, remaining);
+            unsigned long long content_size = ZSTD_getFrameContentSize(begin, remaining);
+            if (ZSTD_isError(compressed_size) ||
+                content_size == ZSTD_CONTENTSIZE_UNKNOWN || content_size == ZSTD_CONTENTSIZE_ERROR) {
+                return {};
+            }
+            blocks.push_back({std::string_view(begin, compressed_size), static_cast<std::size_t>(content_size)});
+            begin += compressed_size;
+        }
+        return blocks;
+    }
+#endif
+
+    inline std::unique_ptr<decoder> make_decoder(compression_type compression) {
+        switch (compression) {
+#ifdef FMM_USE_ZLIB
+            case GzipCompression: return std::make_unique<gzip_decoder>();
+#endif
+#ifdef FMM_USE_BZIP2
+            case Bzip2Compression: return std::make_unique<bzip2_decoder>();
+#endif
+#ifdef FMM_USE_ZSTD
+            case ZstdCompression: return std::make_unique<zstd_decoder>();
+#endif
+            default:
+                throw fmm_error("Input is " + compression_name(compression) +
+                                "-compressed, but this build of fast_matrix_market cannot decompress it.");
+        }
+    }
+
+    /**
+     * Split a compressed input into blocks that can be decompressed in parallel.
+     *
+     * @return the blocks, or empty if there are fewer than two or the input is not made of self-describing blocks.
+     */
+    inline std::vector<compressed_block> find_compressed_blocks(compression_type compression,
+                                                                const char* begin, const char* end) {
+        std::vector<compressed_block> blocks;
+        switch (compression) {
+#ifdef FMM_USE_ZLIB
+            case GzipCompression: blocks = find_gzip_blocks(begin, end); break;
+#endif
+#ifdef FMM_USE_ZSTD
+            case ZstdCompression: blocks = find_zstd_blocks(begin, end); break;
+#endif
+            default: break;
+        }
+        if (blocks.size() < 2) {
+            return {};
+        }
+        return blocks;
+    }
+
+    /**
+     * Decompress one block found by find_compressed_blocks(). Thread safe.
+     */
+    inline std::string decompress_block(compression_type compression, const compressed_block& block) {
+        std::string decompressed(block.decompressed_size, '\0');
+        switch (compression) {
+#ifdef FMM_USE_ZLIB
+            case GzipCompression: {
+                z_stream zs{};
+                // 15 + 16: maximum window size, gzip wrapper.
+                if (inflateInit2(&zs, 15 + 16) != Z_OK) {
+                    throw fmm_error("Cannot initialize zlib.");
+                }
+                zs.next_in = reinterpret_cast<Bytef*>(const_cast<char*>(block.data.data()));
+                zs.avail_in = static_cast<uInt>(block.data.size());
+                zs.next_out = reinterpret_cast<Bytef*>(decompressed.data());
+                zs.avail_out = static_cast<uInt>(decompressed.size());
+                int ret = inflate(&zs, Z_FINISH);
+                std::string msg = (zs.msg != nullptr ? zs.msg : "truncated or corrupt block");
+                decompressed.resize(zs.total_out);
+                inflateEnd(&zs);
+                if (ret != Z_STREAM_END) {
+                    throw fmm_error("Error decompressing gzip input: " + msg);
+                }
+                return decompressed;
+            }
+#endif
+#ifdef FMM_USE_ZSTD
+            case ZstdCompression: {
+                std::size_t ret = ZSTD_decompress(decompressed.data(), decompressed.size(),
+                                                  block.data.data(), block.data.size());
+                if (ZSTD_isError(ret)) {
+                    throw fmm_error(std::string("Error decompressing zstd input: ") + ZSTD_getErrorName(ret));
+                }
+                decompressed.resize(ret);
+                return decompressed;
+            }
+#endif
+            default:
+                // find_compressed_blocks() only returns blocks of supported formats.
+                throw fmm_error("Cannot decompress " + compression_name(compression) + " blocks.");
+        }
+    }
+
+    /**
+     * A read-only streambuf that decompresses gzip, bzip2, or zstd input as it is read.
+     *
+     * The format is detected from the input's magic bytes. Input that is not compressed is passed through.
+     *
+     * This is a stage ahead of the chunk reader: the body is split into chunks and parsed in parallel as it is
+     * decompressed. A memory-backed input made of independent blocks also has its blocks decompressed in parallel on
+     * the read thread pool. That covers multi-frame zstd, such as written by pzstd or compress_ostream, and gzip
+     * members that record their own size, such as written by compress_ostream.
+     *
+     * Decompression errors are thrown as fmm_error. Set the stream's exception mask to include badbit to have
+     * std::istream rethrow them.
+     */
+    class decompress_streambuf : public std::streambuf {
+    public:
+        /**
+         * Decompress a memory range, such as a memory-mapped file.
+         */
+        decompress_streambuf(const char* begin, const char* end, const read_options& options = {}) :
+                in_pos(begin), in_end(end), source_done(true) {
+            init(options);
+        }
+
+        /**
+         * Decompress bytes read from another streambuf.
+         */
+        explicit decompress_streambuf(std::streambuf* source, const read_options& options = {}) :
+                source(source), in_buffer(kInputBufferSize) {
+            in_pos = in_end = in_buffer.data();
+
+            // Read enough to detect the format.
+            while (!source_done && in_end - in_pos < 4) {
+                refill();
+            }
+            init(options);
+        }
+
+        [[nodiscard]] compression_type get_compression() const {
+            return compression;
+        }
+
+    protected:
+        static constexpr std::size_t kInputBufferSize = 1 << 18;
+        static constexpr std::size_t kOutputBufferSize = 1 << 20;
+
+        void init(const read_options& options) {
+            compression = detect_compression(in_pos, static_cast<std::size_t>(in_end - in_pos));
+            if (compression == NoCompression) {
+                return;
+            }
+
+            if (source == nullptr) {
+                blocks = find_compressed_blocks(compression, in_pos, in_end);
+                if (!blocks.empty()) {
+                    pool = std::make_unique<scoped_thread_pool>(options);
+                    return;
+                }
+            }
+            dec = make_decoder(compression);
+            out_buffer.resize(kOutputBufferSize);
+        }
+
+        /**
+         * Read more input from the source streambuf. Keeps unconsumed input.
+         */
+        void refill() {
+            auto leftover = static_cast<std::size_t>(in_end - in_pos);
+            if (in_pos != in_buffer.data()) {
+                std::copy(in_pos, in_end, in_buffer.data());
+            }
+            in_pos = in_buffer.data();
+            in_end = in_pos + leftover;
+
+            auto num_read = source->sgetn(in_buffer.data() + leftover, static_cast<std::streamsize>(in_buffer.size() - leftover));
+            if (num_read <= 0) {
+                source_done = true;
+            } else {
+                in_end += num_read;
+            }
+        }
+
+        int_type underflow() override {
+            if (gptr() < egptr()) {
+                return traits_type::to_int_type(*gptr());
+            }
+
+            if (compression == NoCompression) {
+                // Pass through
+                if (in_pos == in_end && !source_done) {
+                    refill();
+                }
+                if (in_pos == in_end) {
+                    return traits_type::eof();
+                }
+                setg(const_cast<char*>(in_pos), const_cast<char*>(in_pos), const_cast<char*>(in_end));
+                in_pos = in_end;
+                return traits_type::to_int_type(*gptr());
+            }
+
+            if (pool) {
+                return underflow_blocks();
+            }
+
+            while (true) {
+                if (in_pos == in_end && !source_done) {
+                    refill();
+                }
+                const char* before = in_pos;
+                std::size_t num_out = dec->decode(in_pos, in_end, out_buffer.data(), out_buffer.size());
+                if (num_out > 0) {
+                    setg(out_buffer.data(), out_buffer.data(), out_buffer.data() + num_out);
+                    return traits_type::to_int_type(*gptr());
+                }
+
+                if (in_pos == before) {
+                    // No progress
+                    if (!source_done) {
+                        refill();
+                        continue;
+                    }
+                    if (in_pos == in_end && dec->at_stream_end()) {
+                        return traits_type::eof();
+                    }
+                    throw fmm_error("Truncated " + compression_name(compression) + " input.");
+                }
+            }
+        }
+
+        /**
+         * Hand out the decompressed blocks in order, keeping enough blocks in flight to occupy the pool.
+         */
+        int_type underflow_blocks() {
+            const std::size_t max_in_flight = 2 * static_cast<std::size_t>(pool->get_num_threads());
+            while (next_block < blocks.size() && in_flight.size() < max_in_flight) {
+                in_flight.push_back(pool->submit([compression = compression, block = blocks[next_block++]] {
+                    return decompress_block(compression, block);
+                }));
+            }
+
+            while (!in_flight.empty()) {
+                current_block = in_flight.front().get();
+                in_flight.pop_front();
+                if (!current_block.empty()) {
+                    setg(current_block.data(), current_block.data(), current_block.data() + current_block.size());
+                    return traits_type::to_int_type(*gptr());
+                }
+            }
+            return traits_type::eof();
+        }
+
+        compression_type compression = NoCompression;
+        std::unique_ptr<decoder> dec;
+
+        // Input
+        std::streambuf* source = nullptr;
+        std::vector<char> in_buffer;
+        const char* in_pos = nullptr;
+        const char* in_end = nullptr;
+        bool source_done = false;
+
+        std::vector<char> out_buffer;
+
+        std::vector<compressed_block> blocks;
+        std::size_t next_block = 0;
+        std::string current_block;
+        // Declared last so its destructor waits for outstanding blocks before anything they use is destroyed.
+        std::deque<std::future<std::string>> in_flight;
+        std::unique_ptr<scoped_thread_pool> pool;
+    };
+
+    /**
+     * An input stream that transparently decompresses gzip, bzip2, or zstd input. See decompress_streambuf.
+     *
+     * Wrap any std::istream, then pass this to any read_matrix_market_* method:
+     * @code
+     * std::ifstream f("matrix.mtx.gz", std::ios_base::binary);
+     * fast_matrix_market::decompress_istream decompressed(f);
+     * fast_matrix_market::read_matrix_market_triplet(decompressed, ...);
+     * @endcode
+     *
+     * Paths passed to read methods, and mapped_istream, decompress automatically.
+     */
+    class decompress_istream : public std::istream {
+    public:
+        explicit decompress_istream(std::istream& source, const read_options& options = {}) :
+                std::istream(nullptr), buf(source.rdbuf(), options) {
+            rdbuf(&buf);
+            exceptions(std::ios_base::badbit);
+        }
+
+        [[nodiscard]] compression_type get_compression() const {
+            return buf.get_compression();
+        }
+
+    protected:
+        decompress_streambuf buf;
+    };
+}
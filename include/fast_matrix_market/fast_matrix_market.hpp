@@ -69,6 +69,14 @@ namespace fast_matrix_market {
         explicit out_of_range(std::string msg): invalid_mm(std::move(msg)) {}
     };
 
+    /**
+     * A read or write was cancelled by its progress callback. See read_options::progress_callback.
+     */
+    class operation_cancelled : public fmm_error {
+    public:
+        explicit operation_cancelled(std::string msg): fmm_error(std::move(msg)) {}
+    };
+
     /**
      * Passed in argument was not valid.
      */
@@ -157,7 +165,7 @@ namespace fast_matrix_market {
      * @param flag flag bit to test for
      * @return true if the flag bit is set in flags, false otherwise
      */
-    inline bool test_flag(int flags, int flag) {
+    constexpr bool test_flag(int flags, int flag) {
         return (flags & flag) == flag;
     }
 
@@ -216,6 +224,9 @@ namespace fast_matrix_market {
 #include "parse_handlers.hpp"
 #include "formatters.hpp"
 #include "read_body.hpp"
+#include "mapped_file.hpp"
+#include "binary_cache.hpp"
+#include "line_index.hpp"
 #include "write_body.hpp"
 #include "app/array.hpp"
 #include "app/doublet.hpp"
@@ -9,6 +9,7 @@
 #include <cstring>
 #include <complex>
 #include <limits>
+#include <string_view>
 #include <iomanip>
 #include <type_traits>
 
@@ -25,6 +26,7 @@
 #endif
 
 #include "fast_matrix_market.hpp"
+#include "simd.hpp"
 
 namespace fast_matrix_market {
     ///////////////////////////////////////////
@@ -35,11 +37,20 @@ namespace fast_matrix_market {
         return pos + std::strspn(pos, " \t\r");
     }
 
-    inline const char* skip_spaces_and_newlines(const char* pos, int64_t& line_num) {
+    /**
+     * Skip spaces and empty lines.
+     *
+     * Never reads past `end`. Chunks may be views into a larger buffer, so the byte at `end` may belong to the
+     * next chunk.
+     */
+    inline const char* skip_spaces_and_newlines(const char* pos, const char* end, int64_t& line_num) {
         pos = skip_spaces(pos);
-        while (*pos == '\n') {
+        while (pos != end && *pos == '\n') {
             ++line_num;
             ++pos;
+            if (pos == end) {
+                break;
+            }
             pos = skip_spaces(pos);
         }
         return pos;
@@ -133,11 +144,42 @@ namespace fast_matrix_market {
         return ret;
     }
 
+    /**
+     * Parse an unsigned run of digits using SIMD.
+     *
+     * Only handles the common case: at least 16 readable bytes and few enough digits that the value cannot
+     * overflow IT. Signs, invalid values, and long digit runs are left to the other methods so they keep their
+     * overflow detection and error messages.
+     *
+     * @return the end of the parsed integer, or nullptr if the SIMD method does not apply.
+     */
+    template <typename IT>
+    const char* read_int_simd([[maybe_unused]] const char* pos, [[maybe_unused]] const char* end,
+                              [[maybe_unused]] IT& out) {
+#ifdef FMM_SIMD_SSSE3
+        if constexpr (std::is_integral_v<IT> && !std::is_same_v<IT, bool>) {
+            constexpr int max_digits = std::numeric_limits<IT>::digits10 < 15 ? std::numeric_limits<IT>::digits10 : 15;
+            if (end - pos >= 16 && simd::cpu_has_ssse3()) {
+                uint64_t value;
+                int length = simd::parse_digits_ssse3(pos, value);
+                if (length > 0 && length <= max_digits) {
+                    out = static_cast<IT>(value);
+                    return pos + length;
+                }
+            }
+        }
+#endif
+        return nullptr;
+    }
+
     /**
      * Parse integer using best available method
      */
     template <typename IT>
     const char* read_int(const char* pos, const char* end, IT& out) {
+        if (const char* simd_end = read_int_simd(pos, end, out); simd_end != nullptr) {
+            return simd_end;
+        }
 #ifdef FMM_FROM_CHARS_INT_SUPPORTED
         return read_int_from_chars(pos, end, out);
 #else
@@ -638,4 +680,152 @@ namespace fast_matrix_market {
     std::string value_to_string(const T& value, int precision) {
         return value_to_string_fallback(value, precision);
     }
-}
\ No newline at end of file
+
+    ////////////////////////////////////////////
+    // Value to char buffer conversions
+    // These write in place and produce the same text as the value_to_string() methods above.
+    ////////////////////////////////////////////
+
+    /**
+     * Whether value_to_chars() has an overload for T.
+     */
+    template <typename T>
+    constexpr bool has_value_to_chars() {
+        if constexpr (is_complex<T>::value) {
+            return has_value_to_chars<typename T::value_type>();
+        } else {
+            return std::is_same_v<T, pattern_placeholder_type> || std::is_integral_v<T>
+                   || std::is_same_v<T, float> || std::is_same_v<T, double>;
+        }
+    }
+
+    /**
+     * Upper bound on the number of chars value_to_chars() writes for a value of type T.
+     *
+     * @return the bound, or 0 if value_to_chars() does not support T with this precision. Use value_to_string()
+     * for those.
+     */
+    template <typename T>
+    constexpr std::size_t value_chars_bound([[maybe_unused]] int precision) {
+        if constexpr (std::is_same_v<T, pattern_placeholder_type> || std::is_same_v<T, bool>) {
+            return 1;
+        } else if constexpr (std::is_integral_v<T>) {
+            // Sign, digits, and one more in case the value is promoted, e.g. by index + 1.
+            return std::numeric_limits<T>::digits10 + 3;
+        } else if constexpr (std::is_same_v<T, float> || std::is_same_v<T, double>) {
+            // Sign, significand digits, decimal point, exponent, with room to spare.
+            [[maybe_unused]] constexpr std::size_t shortest_bound = 32;
+            [[maybe_unused]] constexpr std::size_t precision_overhead = 16;
+            if (precision < 0) {
+#if defined(FMM_USE_DRAGONBOX) || defined(FMM_TO_CHARS_DOUBLE_SUPPORTED) || defined(FMM_USE_RYU)
+                return shortest_bound;
+#endif
+            } else {
+#if defined(FMM_TO_CHARS_DOUBLE_SUPPORTED) || defined(FMM_USE_RYU)
+                return static_cast<std::size_t>(precision) + precision_overhead;
+#endif
+            }
+            return 0;
+        } else if constexpr (is_complex<T>::value) {
+            std::size_t component = value_chars_bound<typename T::value_type>(precision);
+            return component == 0 ? 0 : 2 * component + 1;
+        } else {
+            return 0;
+        }
+    }
+
+    /**
+     * Convert integral types to chars.
+     *
+     * @param out must have room for value_chars_bound<T>() chars.
+     * @return one past the last char written.
+     */
+    template <typename T>
+    char* int_to_chars(char* out, const T& value) {
+#ifdef FMM_TO_CHARS_INT_SUPPORTED
+        return std::to_chars(out, out + std::numeric_limits<T>::digits10 + 3, value).ptr;
+#else
+        std::string s = int_to_string(value);
+        return std::copy(s.begin(), s.end(), out);
+#endif
+    }
+
+    inline char* value_to_chars(char* out, [[maybe_unused]] const pattern_placeholder_type& value, [[maybe_unused]] int precision) {
+        return out;
+    }
+
+    inline char* value_to_chars(char* out, const bool& value, [[maybe_unused]] int precision) {
+        *out = value ? '1' : '0';
+        return out + 1;
+    }
+
+    template <typename T, typename std::enable_if<std::is_integral_v<T>, int>::type = 0>
+    char* value_to_chars(char* out, const T& value, [[maybe_unused]] int precision) {
+        return int_to_chars(out, value);
+    }
+
+    /**
+     * float and double to chars. Uses the same preference order as value_to_string().
+     *
+     * @param out must have room for value_chars_bound<T>(precision) chars, which must not be 0.
+     */
+    template <typename T, typename std::enable_if<std::is_same_v<T, float> || std::is_same_v<T, double>, int>::type = 0>
+    char* value_to_chars(char* out, const T& value, int precision) {
+        char* end = out;
+        bool shortest_e0 = false;
+
+#ifdef FMM_USE_DRAGONBOX
+        if (precision < 0) {
+            end = jkj::dragonbox::to_chars(value, out);
+            shortest_e0 = true;
+        } else
+#endif
+        {
+#ifdef FMM_TO_CHARS_DOUBLE_SUPPORTED
+            char* bound_end = out + value_chars_bound<T>(precision);
+            if (precision < 0) {
+                end = std::to_chars(out, bound_end, value).ptr;
+            } else {
+                end = std::to_chars(out, bound_end, value, std::chars_format::general, precision).ptr;
+            }
+#elif defined(FMM_USE_RYU)
+            if (precision < 0) {
+                if constexpr (std::is_same_v<T, float>) {
+                    end = out + f2s_buffered_n(value, out);
+                } else {
+                    end = out + d2s_buffered_n(value, out);
+                }
+                shortest_e0 = true;
+            } else {
+                // d2exp_buffered_n's precision means number of places after the decimal point, but
+                // we expect it to mean number of sigfigs.
+                end = out + d2exp_buffered_n(static_cast<double>(value), precision > 0 ? precision - 1 : 0, out);
+#if FMM_DROP_ENDING_E0_PRECISION
+                if (end - out >= 4 && std::string_view(end - 4, 4) == "e+00") {
+                    end -= 4;
+                }
+#endif
+            }
+#else
+            std::string s = value_to_string(value, precision);
+            end = std::copy(s.begin(), s.end(), out);
+#endif
+        }
+
+#if FMM_DROP_ENDING_E0
+        if (shortest_e0 && end - out >= 2 && end[-2] == 'E' && end[-1] == '0') {
+            end -= 2;
+        }
+#else
+        (void)shortest_e0;
+#endif
+        return end;
+    }
+
+    template <typename COMPLEX, typename std::enable_if<is_complex<COMPLEX>::value, int>::type = 0>
+    char* value_to_chars(char* out, const COMPLEX& value, int precision) {
+        out = value_to_chars(out, value.real(), precision);
+        *out++ = ' ';
+        return value_to_chars(out, value.imag(), precision);
+    }
+}
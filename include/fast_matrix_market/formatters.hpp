@@ -5,12 +5,67 @@
 #pragma once
 
 #include <algorithm>
+#include <string>
+#include <string_view>
 #include <utility>
 
 #include "fast_matrix_market.hpp"
+#include "buffer_pool.hpp"
 
 namespace fast_matrix_market {
 
+    /**
+     * Output buffer for a chunk of formatted lines.
+     *
+     * Line formatters reserve() room for a worst-case line, write directly into the returned pointer, then commit()
+     * the end of what they wrote. No temporary strings are created per line or per value.
+     *
+     * The buffer comes from current_chunk_buffer_pool(), if set.
+     */
+    class chunk_output {
+    public:
+        explicit chunk_output(std::size_t capacity_hint = 0) {
+            if (auto* pool = current_chunk_buffer_pool()) {
+                buffer = pool->acquire(capacity_hint);
+            }
+            buffer.resize(capacity_hint);
+        }
+
+        /**
+         * @return a pointer to at least `n` writable chars following the committed text.
+         */
+        char* reserve(std::size_t n) {
+            if (buffer.size() < used + n) {
+                buffer.resize(std::max(used + n, 2 * buffer.size()));
+            }
+            return buffer.data() + used;
+        }
+
+        /**
+         * Mark everything up to `end` as written. `end` must be within the last reserve().
+         */
+        void commit(const char* end) {
+            used = end - buffer.data();
+        }
+
+        void append(std::string_view s) {
+            commit(std::copy(s.begin(), s.end(), reserve(s.size())));
+        }
+
+        /**
+         * @return the written text. The buffer is left empty.
+         */
+        std::string release() {
+            buffer.resize(used);
+            used = 0;
+            return std::move(buffer);
+        }
+
+    protected:
+        std::string buffer;
+        std::size_t used = 0;
+    };
+
     /**
      * Format individual lines (matrix version).
      */
@@ -18,56 +73,98 @@ namespace fast_matrix_market {
     class line_formatter {
     public:
         line_formatter(const matrix_market_header &header, const write_options &options) : header(header),
-                                                                                           options(options) {}
+                                                                                           options(options) {
+            if constexpr (has_value_to_chars<VT>()) {
+                value_chars = value_chars_bound<VT>(options.precision);
+            }
+        }
 
-        std::string coord_matrix(const IT& row, const IT& col, const VT& val) {
+        void coord_matrix(chunk_output& out, const IT& row, const IT& col, const VT& val) {
             if (header.format == array) {
-                return array_matrix(row, col, val);
+                array_matrix(out, row, col, val);
+                return;
             }
 
-            std::string line{};
-            line += int_to_string(row + 1);
-            line += kSpace;
-            line += int_to_string(col + 1);
+            char* pos = out.reserve(2 * index_chars + value_chars + 3);
+            pos = int_to_chars(pos, row + 1);
+            *pos++ = kSpace[0];
+            pos = int_to_chars(pos, col + 1);
 
             if (header.field != pattern) {
-                line += kSpace;
-                line += value_to_string(val, options.precision);
+                *pos++ = kSpace[0];
+                pos = write_value(out, pos, val);
             }
-            line += kNewline;
-
-            return line;
+            *pos++ = kNewline[0];
+            out.commit(pos);
         }
 
-        std::string coord_matrix_pattern(const IT& row, const IT& col) {
-            std::string line{};
-            line += int_to_string(row + 1);
-            line += kSpace;
-            line += int_to_string(col + 1);
-            line += kNewline;
-
-            return line;
+        void coord_matrix_pattern(chunk_output& out, const IT& row, const IT& col) {
+            char* pos = out.reserve(2 * index_chars + 2);
+            pos = int_to_chars(pos, row + 1);
+            *pos++ = kSpace[0];
+            pos = int_to_chars(pos, col + 1);
+            *pos++ = kNewline[0];
+            out.commit(pos);
         }
 
-        std::string array_matrix(const IT& row, const IT& col, const VT& val) {
+        void array_matrix(chunk_output& out, const IT& row, const IT& col, const VT& val) {
             if (header.symmetry != general) {
                 if (row < col) {
                     // omit upper triangle
-                    return {};
+                    return;
                 }
                 if (header.symmetry == skew_symmetric && row == col) {
                     // omit diagonal for skew-symmetric
-                    return {};
+                    return;
                 }
             }
 
-            std::string ret = value_to_string(val, options.precision);
-            ret += kNewline;
-            return ret;
+            char* pos = out.reserve(value_chars + 1);
+            pos = write_value(out, pos, val);
+            *pos++ = kNewline[0];
+            out.commit(pos);
+        }
+
+        std::string coord_matrix(const IT& row, const IT& col, const VT& val) {
+            chunk_output out;
+            coord_matrix(out, row, col, val);
+            return out.release();
+        }
+
+        std::string coord_matrix_pattern(const IT& row, const IT& col) {
+            chunk_output out;
+            coord_matrix_pattern(out, row, col);
+            return out.release();
+        }
+
+        std::string array_matrix(const IT& row, const IT& col, const VT& val) {
+            chunk_output out;
+            array_matrix(out, row, col, val);
+            return out.release();
         }
     protected:
+        /**
+         * Write a value at `pos`, which is in a reservation of at least value_chars + 1 chars.
+         *
+         * @return one past the value. There is room for at least one more char.
+         */
+        char* write_value(chunk_output& out, char* pos, const VT& val) {
+            if constexpr (has_value_to_chars<VT>()) {
+                if (value_chars != 0) {
+                    return value_to_chars(pos, val, options.precision);
+                }
+            }
+
+            // No bound on this type's length, so go through a string.
+            std::string str = value_to_string(val, options.precision);
+            out.commit(pos);
+            return std::copy(str.begin(), str.end(), out.reserve(str.size() + 1));
+        }
+
         const matrix_market_header& header;
         const write_options& options;
+        static constexpr std::size_t index_chars = value_chars_bound<IT>(-1);
+        std::size_t value_chars = 0;
     };
 
     /**
@@ -77,31 +174,63 @@ namespace fast_matrix_market {
     class vector_line_formatter {
     public:
         vector_line_formatter(const matrix_market_header &header, const write_options &options) : header(header),
-                                                                                                  options(options) {}
-        std::string coord_matrix(const IT& row, [[maybe_unused]] const IT& col, const VT& val) {
-            std::string line{};
-            line += int_to_string(row + 1);
+                                                                                                  options(options) {
+            if constexpr (has_value_to_chars<VT>()) {
+                value_chars = value_chars_bound<VT>(options.precision);
+            }
+        }
+
+        void coord_matrix(chunk_output& out, const IT& row, [[maybe_unused]] const IT& col, const VT& val) {
+            char* pos = out.reserve(index_chars + value_chars + 2);
+            pos = int_to_chars(pos, row + 1);
 
             if (header.field != pattern) {
-                line += kSpace;
-                line += value_to_string(val, options.precision);
+                *pos++ = kSpace[0];
+                pos = write_value(out, pos, val);
             }
-            line += kNewline;
+            *pos++ = kNewline[0];
+            out.commit(pos);
+        }
 
-            return line;
+        void coord_matrix_pattern(chunk_output& out, const IT& row, [[maybe_unused]] const IT& col) {
+            char* pos = out.reserve(index_chars + 1);
+            pos = int_to_chars(pos, row + 1);
+            *pos++ = kNewline[0];
+            out.commit(pos);
         }
 
-        std::string coord_matrix_pattern(const IT& row, [[maybe_unused]] const IT& col) {
-            std::string line{};
-            line += int_to_string(row + 1);
-            line += kNewline;
+        std::string coord_matrix(const IT& row, const IT& col, const VT& val) {
+            chunk_output out;
+            coord_matrix(out, row, col, val);
+            return out.release();
+        }
 
-            return line;
+        std::string coord_matrix_pattern(const IT& row, const IT& col) {
+            chunk_output out;
+            coord_matrix_pattern(out, row, col);
+            return out.release();
         }
 
     protected:
+        /**
+         * See line_formatter::write_value().
+         */
+        char* write_value(chunk_output& out, char* pos, const VT& val) {
+            if constexpr (has_value_to_chars<VT>()) {
+                if (value_chars != 0) {
+                    return value_to_chars(pos, val, options.precision);
+                }
+            }
+
+            std::string str = value_to_string(val, options.precision);
+            out.commit(pos);
+            return std::copy(str.begin(), str.end(), out.reserve(str.size() + 1));
+        }
+
         const matrix_market_header& header;
         const write_options& options;
+        static constexpr std::size_t index_chars = value_chars_bound<IT>(-1);
+        std::size_t value_chars = 0;
     };
 
     /**
@@ -147,19 +276,18 @@ namespace fast_matrix_market {
                     val_iter(val_begin), val_end(val_end) {}
 
             std::string operator()() {
-                std::string chunk;
-                chunk.reserve((row_end - row_iter)*25);
+                chunk_output chunk((row_end - row_iter)*25);
 
                 for (; row_iter != row_end; ++row_iter, ++col_iter) {
                     if (val_iter != val_end) {
-                        chunk += line_formatter.coord_matrix(*row_iter, *col_iter, *val_iter);
+                        line_formatter.coord_matrix(chunk, *row_iter, *col_iter, *val_iter);
                         ++val_iter;
                     } else {
-                        chunk += line_formatter.coord_matrix_pattern(*row_iter, *col_iter);
+                        line_formatter.coord_matrix_pattern(chunk, *row_iter, *col_iter);
                     }
                 }
 
-                return chunk;
+                return chunk.release();
             }
 
             LF line_formatter;
@@ -236,8 +364,7 @@ namespace fast_matrix_market {
                     transpose(transpose) {}
 
             std::string operator()() {
-                std::string chunk;
-                chunk.reserve((ptr_end - ptr_iter)*250);
+                chunk_output chunk((ptr_end - ptr_iter)*250);
 
                 // emit the columns [ptr_iter, ptr_end)
 
@@ -261,15 +388,15 @@ namespace fast_matrix_market {
                         }
 
                         if (val_iter != val_end) {
-                            chunk += line_formatter.coord_matrix(lf_row, lf_col, *val_iter);
+                            line_formatter.coord_matrix(chunk, lf_row, lf_col, *val_iter);
                             ++val_iter;
                         } else {
-                            chunk += line_formatter.coord_matrix_pattern(lf_row, lf_col);
+                            line_formatter.coord_matrix_pattern(chunk, lf_row, lf_col);
                         }
                     }
                 }
 
-                return chunk;
+                return chunk.release();
             }
 
             LF line_formatter;
@@ -324,8 +451,7 @@ namespace fast_matrix_market {
                     line_formatter(lf), values(values), order(order), nrows(nrows), ncols(ncols), cur_col(cur_col) {}
 
             std::string operator()() {
-                std::string c;
-                c.reserve(ncols * 15);
+                chunk_output c(nrows * 15);
 
                 for (int64_t row = 0; row < nrows; ++row) {
                     int64_t offset;
@@ -335,10 +461,10 @@ namespace fast_matrix_market {
                         offset = cur_col * nrows + row;
                     }
 
-                    c += line_formatter.array_matrix(row, cur_col, *(values + offset));
+                    line_formatter.array_matrix(c, row, cur_col, *(values + offset));
                 }
 
-                return c;
+                return c.release();
             }
 
             LF line_formatter;
@@ -382,19 +508,18 @@ namespace fast_matrix_market {
                     line_formatter(lf), mat(mat), nrows(nrows), col_iter(col_iter), col_end(col_end) {}
 
             std::string operator()() {
-                std::string chunk;
-                chunk.reserve((col_end - col_iter) * nrows * 15);
+                chunk_output chunk((col_end - col_iter) * nrows * 15);
 
                 // iterate over assigned columns
                 for (; col_iter != col_end; ++col_iter) {
 
                     for (DIM row = 0; row < nrows; ++row)
                     {
-                        chunk += line_formatter.array_matrix(row, col_iter, mat(row, col_iter));
+                        line_formatter.array_matrix(chunk, row, col_iter, mat(row, col_iter));
                     }
                 }
 
-                return chunk;
+                return chunk.release();
             }
 
             LF line_formatter;
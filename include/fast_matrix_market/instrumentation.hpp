@@ -0,0 +1,242 @@
+// Copyright (C) 2023 Adam Lugowski. All rights reserved.
+// Use of this source code is governed by the BSD 2-clause license found in the LICENSE.txt file.
+// SPDX-License-Identifier: BSD-2-Clause
+
+#pragma once
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <future>
+#include <memory>
+
+#if defined(__unix__) || defined(__APPLE__)
+#include <time.h>
+#if defined(CLOCK_THREAD_CPUTIME_ID)
+#define FMM_HAVE_THREAD_CPUTIME 1
+#endif
+#endif
+
+#include "fast_matrix_market.hpp"
+#include "thread_pool.hpp"
+
+namespace fast_matrix_market {
+
+    inline int64_t wall_time_ns() {
+        return std::chrono::duration_cast<std::chrono::nanoseconds>(
+            std::chrono::steady_clock::now().time_since_epoch()).count();
+    }
+
+    /**
+     * @return CPU time used by the calling thread, or 0 if the platform cannot tell.
+     */
+    inline int64_t thread_cpu_time_ns() {
+#ifdef FMM_HAVE_THREAD_CPUTIME
+        timespec ts{};
+        if (clock_gettime(CLOCK_THREAD_CPUTIME_ID, &ts) == 0) {
+            return (int64_t)ts.tv_sec * 1000000000 + ts.tv_nsec;
+        }
+#endif
+        return 0;
+    }
+
+    /**
+     * Collects the measurements of one read or write and adds them to read_options::stats or write_options::stats
+     * when destroyed. Does nothing if stats is not set.
+     *
+     * Stage times may be recorded from any thread. Everything else only from the main thread.
+     */
+    class pipeline_recorder {
+    public:
+        template <typename OPTIONS>
+        explicit pipeline_recorder(const OPTIONS& options) : stats(options.stats) {
+            if (stats) {
+                start_ns = wall_time_ns();
+            }
+        }
+
+        ~pipeline_recorder() {
+            if (!stats) {
+                return;
+            }
+            int64_t worker_busy_ns = 0;
+            for (int stage = 0; stage < kNumPipelineStages; ++stage) {
+                auto& out = stats->stages[stage];
+                out.count += stages[stage].count.load(std::memory_order_relaxed);
+                out.wall_ns += stages[stage].wall_ns.load(std::memory_order_relaxed);
+                out.cpu_ns += stages[stage].cpu_ns.load(std::memory_order_relaxed);
+                worker_busy_ns += stages[stage].worker_wall_ns.load(std::memory_order_relaxed);
+            }
+
+            stats->bytes += bytes;
+            stats->chunks += chunks;
+            stats->stalls += stalls;
+            stats->stall_ns += stall_ns;
+            if (num_threads > 0) {
+                // A parallel pipeline.
+                int64_t wall_ns = wall_time_ns() - start_ns;
+                stats->wall_ns += wall_ns;
+                stats->worker_idle_ns += std::max((int64_t)0, num_threads * wall_ns - worker_busy_ns);
+            }
+        }
+
+        pipeline_recorder(const pipeline_recorder&) = delete;
+        pipeline_recorder& operator=(const pipeline_recorder&) = delete;
+
+        /**
+         * @return this recorder if measurements are taken, else nullptr. Pass to stage_timer.
+         */
+        [[nodiscard]] pipeline_recorder* get() {
+            return stats ? this : nullptr;
+        }
+
+        void add_stage(pipeline_stage stage, int64_t wall_ns, int64_t cpu_ns, bool on_worker) {
+            auto& s = stages[stage];
+            s.count.fetch_add(1, std::memory_order_relaxed);
+            s.wall_ns.fetch_add(wall_ns, std::memory_order_relaxed);
+            s.cpu_ns.fetch_add(cpu_ns, std::memory_order_relaxed);
+            if (on_worker) {
+                s.worker_wall_ns.fetch_add(wall_ns, std::memory_order_relaxed);
+            }
+        }
+
+        /**
+         * A chunk of `chunk_bytes` went through the pipeline.
+         */
+        void add_chunk(int64_t chunk_bytes) {
+            ++chunks;
+            bytes += chunk_bytes;
+        }
+
+        /**
+         * Set the number of worker threads, to compute their idle time. Only parallel pipelines set this.
+         */
+        void set_num_threads(int64_t threads) {
+            num_threads = threads;
+        }
+
+        /**
+         * Wait on a future. Time spent waiting is a stall.
+         */
+        template <typename R>
+        R get(std::future<R>& future) {
+            if (!stats || is_ready(future)) {
+                return future.get();
+            }
+            ++stalls;
+            int64_t start = wall_time_ns();
+            future.wait();
+            stall_ns += wall_time_ns() - start;
+            return future.get();
+        }
+
+    protected:
+        struct stage_counters {
+            std::atomic<int64_t> count{0};
+            std::atomic<int64_t> wall_ns{0};
+            std::atomic<int64_t> cpu_ns{0};
+            std::atomic<int64_t> worker_wall_ns{0};
+        };
+
+        std::shared_ptr<pipeline_stats> stats;
+        stage_counters stages[kNumPipelineStages];
+        int64_t start_ns = 0;
+        int64_t bytes = 0;
+        int64_t chunks = 0;
+        int64_t stalls = 0;
+        int64_t stall_ns = 0;
+        int64_t num_threads = 0;
+    };
+
+    /**
+     * Times its own lifetime as one run of a pipeline stage. Does nothing if `recorder` is nullptr.
+     */
+    class stage_timer {
+    public:
+        /**
+         * @param on_worker whether this runs on a pool thread. Used to compute worker idle time.
+         */
+        stage_timer(pipeline_recorder* recorder, pipeline_stage stage, bool on_worker = true) :
+            recorder(recorder), stage(stage), on_worker(on_worker) {
+            if (recorder) {
+                start_wall_ns = wall_time_ns();
+                start_cpu_ns = thread_cpu_time_ns();
+            }
+        }
+
+        ~stage_timer() {
+            if (recorder) {
+                recorder->add_stage(stage, wall_time_ns() - start_wall_ns, thread_cpu_time_ns() - start_cpu_ns, on_worker);
+            }
+        }
+
+        stage_timer(const stage_timer&) = delete;
+        stage_timer& operator=(const stage_timer&) = delete;
+
+    protected:
+        pipeline_recorder* recorder;
+        pipeline_stage stage;
+        bool on_worker;
+        int64_t start_wall_ns = 0;
+        int64_t start_cpu_ns = 0;
+    };
+
+    /**
+     * Calls read_options::progress_callback or write_options::progress_callback as chunks complete, and cancels the
+     * pipeline if it returns false. Used only by a pipeline's main thread.
+     */
+    class progress_reporter {
+    public:
+        /**
+         * @param pool the pipeline's pool, to skip its remaining tasks on cancellation. nullptr if sequential.
+         */
+        template <typename OPTIONS>
+        explicit progress_reporter(const OPTIONS& options, scoped_thread_pool* pool = nullptr) :
+            callback(options.progress_callback), pool(pool) {}
+
+        [[nodiscard]] bool is_enabled() const {
+            return (bool)callback;
+        }
+
+        /**
+         * A chunk of `chunk_bytes` bytes and `chunk_elements` elements completed.
+         *
+         * Throws operation_cancelled if the callback returns false.
+         */
+        void add_chunk(int64_t chunk_bytes, int64_t chunk_elements) {
+            if (!callback) {
+                return;
+            }
+            ++progress.chunks;
+            progress.bytes += chunk_bytes;
+            progress.elements += chunk_elements;
+            if (!callback(progress)) {
+                if (pool) {
+                    pool->cancel();
+                }
+                throw operation_cancelled("Cancelled by progress callback.");
+            }
+        }
+
+    protected:
+        const progress_callback_type& callback;
+        scoped_thread_pool* pool;
+        progress_info progress;
+    };
+
+    /**
+     * Times one run of a stage that happens outside the parallel pipelines, such as a conversion in an
+     * application binding.
+     */
+    class app_stage_timer {
+    public:
+        template <typename OPTIONS>
+        app_stage_timer(const OPTIONS& options, pipeline_stage stage) :
+            recorder(options), timer(recorder.get(), stage, false) {}
+
+    protected:
+        // The timer records into the recorder, so is declared (and destroyed) after it.
+        pipeline_recorder recorder;
+        stage_timer timer;
+    };
+}
@@ -0,0 +1,326 @@
+// Copyright (C) 2023 Adam Lugowski. All rights reserved.
+// Use of this source code is governed by the BSD 2-clause license found in the LICENSE.txt file.
+// SPDX-License-Identifier: BSD-2-Clause
+
+#pragma once
+
+#include <cstring>
+#include <fstream>
+#include <string>
+#include <vector>
+
+#include "fast_matrix_market.hpp"
+#include "binary_cache.hpp"
+#include "chunking.hpp"
+#include "mapped_file.hpp"
+#include "thread_pool.hpp"
+
+namespace fast_matrix_market {
+
+    /**
+     * Position of one line of a Matrix Market body.
+     */
+    struct line_index_entry {
+        /**
+         * Byte offset of the start of the line from the start of the file.
+         */
+        int64_t byte_offset = 0;
+
+        /**
+         * Number of lines in the file before this one, including the header.
+         */
+        int64_t file_line = 0;
+
+        /**
+         * Number of elements (non-empty body lines) before this one.
+         */
+        int64_t element_num = 0;
+    };
+
+    /**
+     * A sparse index of the element lines of a Matrix Market file.
+     *
+     * Entry i is the line of element i * stride. Use it to read any range of elements without scanning the
+     * file up to it. See read_matrix_market_triplet_range().
+     */
+    struct line_index {
+        /**
+         * Identifies the file version this index was built from. See get_binary_cache_key().
+         */
+        binary_cache_key key;
+
+        int64_t stride = 0;
+
+        /**
+         * Byte offset of the start of the body.
+         */
+        int64_t body_offset = 0;
+
+        /**
+         * Total number of elements (non-empty body lines) in the file.
+         */
+        int64_t num_elements = 0;
+
+        std::vector<line_index_entry> entries;
+    };
+
+    /**
+     * The sidecar line index file of a .mtx file.
+     */
+    inline std::string line_index_path(const std::string& path) {
+        return path + ".fmmindex";
+    }
+
+    /**
+     * Build a line index of an uncompressed Matrix Market file.
+     *
+     * The body is scanned twice in parallel, in chunk_size_bytes ranges. The first pass counts each range's lines,
+     * the second records the position of every stride-th element.
+     *
+     * @param stride number of elements between index entries.
+     */
+    inline line_index build_line_index(const std::string& path, int64_t stride, const read_options& options = {}) {
+        if (stride < 1) {
+            throw invalid_argument("Line index stride must be positive.");
+        }
+
+        line_index index;
+        index.stride = stride;
+        if (!get_binary_cache_key(path, index.key)) {
+            throw invalid_argument("Cannot open file: " + path);
+        }
+
+        matrix_market_header header;
+        {
+            std::ifstream f(path, std::ios_base::binary);
+            char magic[4] = {};
+            f.read(magic, sizeof(magic));
+            if (detect_compression(magic, static_cast<std::size_t>(f.gcount())) != NoCompression) {
+                throw invalid_argument("Cannot index a compressed file: " + path);
+            }
+            f.clear();
+            f.seekg(0);
+            read_header(f, header);
+            index.body_offset = static_cast<int64_t>(f.tellg());
+        }
+
+        // Map the file, or read it if it cannot be mapped.
+        mapped_file file(path);
+        std::string contents;
+        std::string_view body;
+        if (file.is_mapped()) {
+            body = std::string_view(file.begin(), file.size());
+        } else {
+            std::ifstream f(path, std::ios_base::binary);
+            contents.assign(std::istreambuf_iterator<char>(f), std::istreambuf_iterator<char>());
+            body = contents;
+        }
+        body = body.substr(std::min<std::size_t>(static_cast<std::size_t>(index.body_offset), body.size()));
+
+        const auto range_size = static_cast<std::size_t>(std::max(options.chunk_size_bytes, (int64_t)1));
+        const std::size_t num_ranges = (body.size() + range_size - 1) / range_size;
+        auto get_range = [&](std::size_t range_index) {
+            std::size_t begin = snap_to_line_start(body, range_index * range_size);
+            std::size_t end = snap_to_line_start(body, (range_index + 1) * range_size);
+            return std::make_pair(begin, end);
+        };
+
+        scoped_thread_pool pool(options);
+
+        // Pass 1: count lines and elements of each range.
+        std::vector<line_counts> range_starts(num_ranges + 1);
+        {
+            std::vector<std::future<line_counts>> futures;
+            futures.reserve(num_ranges);
+            for (std::size_t range_index = 0; range_index < num_ranges; ++range_index) {
+                futures.push_back(pool.submit([&, range_index]() -> line_counts {
+                    auto [begin, end] = get_range(range_index);
+                    if (begin == end) {
+                        return {0, 0};
+                    }
+                    auto [lines, empties] = count_lines(body.substr(begin, end - begin));
+                    return {lines, lines - empties};
+                }));
+            }
+
+            range_starts[0] = {header.header_line_count, 0};
+            for (std::size_t range_index = 0; range_index < num_ranges; ++range_index) {
+                auto counts = futures[range_index].get();
+                range_starts[range_index + 1] = {range_starts[range_index].file_line + counts.file_line,
+                                                 range_starts[range_index].element_num + counts.element_num};
+            }
+        }
+        index.num_elements = range_starts[num_ranges].element_num;
+
+        // Pass 2: record the indexed elements of each range.
+        index.entries.resize((index.num_elements + stride - 1) / stride);
+        {
+            std::vector<std::future<void>> futures;
+            futures.reserve(num_ranges);
+            for (std::size_t range_index = 0; range_index < num_ranges; ++range_index) {
+                futures.push_back(pool.submit([&, range_index]() {
+                    auto [begin, end] = get_range(range_index);
+                    line_counts lc = range_starts[range_index];
+                    while (begin < end) {
+                        auto line_end = body.find('\n', begin);
+                        line_end = (line_end == std::string_view::npos || line_end >= end) ? end : line_end + 1;
+
+                        auto content_end = body[line_end - 1] == '\n' ? line_end - 1 : line_end;
+                        if (!is_all_spaces(body.data() + begin, body.data() + content_end)) {
+                            if (lc.element_num % stride == 0) {
+                                index.entries[lc.element_num / stride] = {index.body_offset + (int64_t)begin, lc.file_line, lc.element_num};
+                            }
+                            ++lc.element_num;
+                        }
+                        ++lc.file_line;
+                        begin = line_end;
+                    }
+                }));
+            }
+            for (auto& future : futures) {
+                future.get();
+            }
+        }
+
+        return index;
+    }
+
+    /**
+     * Layout of the start of a line index file. The header is followed by the entries.
+     */
+    struct line_index_file_header {
+        char magic[8];
+        uint32_t byte_order;
+        uint32_t version;
+        binary_cache_key key;
+        int64_t stride;
+        int64_t body_offset;
+        int64_t num_elements;
+        uint64_t num_entries;
+    };
+
+    constexpr char kLineIndexMagic[8] = {'F', 'M', 'M', 'I', 'N', 'D', 'E', 'X'};
+    constexpr uint32_t kLineIndexVersion = 1;
+
+    inline void write_line_index(const std::string& index_path, const line_index& index) {
+        line_index_file_header fh{};
+        std::memcpy(fh.magic, kLineIndexMagic, sizeof(fh.magic));
+        fh.byte_order = kBinaryCacheByteOrder;
+        fh.version = kLineIndexVersion;
+        fh.key = index.key;
+        fh.stride = index.stride;
+        fh.body_offset = index.body_offset;
+        fh.num_elements = index.num_elements;
+        fh.num_entries = index.entries.size();
+
+        std::ofstream f(index_path, std::ios_base::binary | std::ios_base::trunc);
+        f.write(reinterpret_cast<const char*>(&fh), sizeof(fh));
+        f.write(reinterpret_cast<const char*>(index.entries.data()),
+                static_cast<std::streamsize>(index.entries.size() * sizeof(line_index_entry)));
+        f.close();
+        if (!f) {
+            throw fmm_error("Error writing line index: " + index_path);
+        }
+    }
+
+    inline line_index read_line_index(const std::string& index_path) {
+        std::ifstream f(index_path, std::ios_base::binary);
+        if (!f) {
+            throw invalid_argument("Cannot open file: " + index_path);
+        }
+
+        line_index_file_header fh{};
+        f.read(reinterpret_cast<char*>(&fh), sizeof(fh));
+        if (!f || std::memcmp(fh.magic, kLineIndexMagic, sizeof(fh.magic)) != 0 ||
+            fh.byte_order != kBinaryCacheByteOrder || fh.version != kLineIndexVersion) {
+            throw invalid_argument("Not a line index file: " + index_path);
+        }
+
+        line_index index;
+        index.key = fh.key;
+        index.stride = fh.stride;
+        index.body_offset = fh.body_offset;
+        index.num_elements = fh.num_elements;
+        index.entries.resize(fh.num_entries);
+        f.read(reinterpret_cast<char*>(index.entries.data()),
+               static_cast<std::streamsize>(index.entries.size() * sizeof(line_index_entry)));
+        if (!f) {
+            throw invalid_argument("Truncated line index file: " + index_path);
+        }
+        return index;
+    }
+
+    /**
+     * The part of a body that holds a range of elements. See read_line_index_span().
+     */
+    struct line_index_span {
+        std::string bytes;
+
+        /**
+         * The file's header, with nnz and header_line_count describing the span instead of the whole body.
+         * Use to parse `bytes` as a body.
+         */
+        matrix_market_header header;
+
+        /**
+         * Number of the first element in the span.
+         */
+        int64_t first_element = 0;
+    };
+
+    /**
+     * Read the bytes of the body that hold elements [first, last) of an indexed file.
+     *
+     * The span starts at an index entry, so it may begin with up to stride - 1 elements before `first` and end with
+     * up to stride - 1 elements after `last`.
+     *
+     * @param header filled with the file's header.
+     */
+    inline line_index_span read_line_index_span(const std::string& path, const line_index& index,
+                                                int64_t first, int64_t last,
+                                                matrix_market_header& header) {
+        binary_cache_key key;
+        if (!get_binary_cache_key(path, key)) {
+            throw invalid_argument("Cannot open file: " + path);
+        }
+        if (!(key == index.key)) {
+            throw invalid_argument("Line index is out of date: " + path);
+        }
+        if (first < 0 || last < first || last > index.num_elements) {
+            throw invalid_argument("Element range [" + std::to_string(first) + ", " + std::to_string(last) +
+                                   ") is outside of [0, " + std::to_string(index.num_elements) + ").");
+        }
+
+        std::ifstream f(path, std::ios_base::binary);
+        read_header(f, header);
+        if (header.format != coordinate) {
+            throw invalid_argument("Element ranges can only be read from coordinate files.");
+        }
+
+        line_index_span span;
+        span.header = header;
+        if (first == last) {
+            span.header.nnz = 0;
+            span.first_element = first;
+            return span;
+        }
+
+        const auto& begin_entry = index.entries[first / index.stride];
+        auto end_entry_i = static_cast<std::size_t>((last + index.stride - 1) / index.stride);
+        bool to_end = end_entry_i >= index.entries.size();
+        int64_t end_offset = to_end ? (int64_t)key.size : index.entries[end_entry_i].byte_offset;
+        int64_t end_element = to_end ? index.num_elements : index.entries[end_entry_i].element_num;
+
+        span.bytes.resize(static_cast<std::size_t>(end_offset - begin_entry.byte_offset));
+        f.seekg(begin_entry.byte_offset);
+        f.read(span.bytes.data(), static_cast<std::streamsize>(span.bytes.size()));
+        if (!f) {
+            throw fmm_error("Error reading file: " + path);
+        }
+
+        span.header.nnz = end_element - begin_entry.element_num;
+        span.header.header_line_count = begin_entry.file_line;
+        span.first_element = begin_entry.element_num;
+        return span;
+    }
+}
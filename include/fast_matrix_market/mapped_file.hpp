@@ -0,0 +1,171 @@
+// Copyright (C) 2023 Adam Lugowski. All rights reserved.
+// Use of this source code is governed by the BSD 2-clause license found in the LICENSE.txt file.
+// SPDX-License-Identifier: BSD-2-Clause
+
+#pragma once
+
+#include <fstream>
+#include <memory>
+#include <string>
+
+#if defined(__unix__) || defined(__APPLE__)
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#define FMM_HAVE_MMAP 1
+#endif
+
+#include "fast_matrix_market.hpp"
+#include "chunking.hpp"
+#include "decompress.hpp"
+
+namespace fast_matrix_market {
+
+    /**
+     * A read-only memory mapping of an entire file.
+     *
+     * Only regular files can be mapped. If the file cannot be mapped (for example it is a pipe, or the platform
+     * lacks mmap()) then is_mapped() returns false.
+     */
+    class mapped_file {
+    public:
+        explicit mapped_file(const std::string& path) {
+#ifdef FMM_HAVE_MMAP
+            int fd = ::open(path.c_str(), O_RDONLY);
+            if (fd < 0) {
+                return;
+            }
+
+            struct stat st{};
+            if (::fstat(fd, &st) != 0 || !S_ISREG(st.st_mode)) {
+                ::close(fd);
+                return;
+            }
+
+            length = static_cast<std::size_t>(st.st_size);
+            if (length == 0) {
+                // Cannot map an empty file, but an empty range is still valid.
+                ::close(fd);
+                mapped = true;
+                return;
+            }
+
+            void* addr = ::mmap(nullptr, length, PROT_READ, MAP_PRIVATE, fd, 0);
+            // The mapping holds its own reference to the file.
+            ::close(fd);
+
+            if (addr == MAP_FAILED) {
+                length = 0;
+                return;
+            }
+
+            // The body is read front to back. Ask for aggressive readahead.
+            ::posix_madvise(addr, length, POSIX_MADV_SEQUENTIAL);
+
+            data = static_cast<const char*>(addr);
+            mapped = true;
+#else
+            (void)path;
+#endif
+        }
+
+        ~mapped_file() {
+#ifdef FMM_HAVE_MMAP
+            if (data != nullptr) {
+                ::munmap(const_cast<char*>(data), length);
+            }
+#endif
+        }
+
+        mapped_file(const mapped_file&) = delete;
+        mapped_file& operator=(const mapped_file&) = delete;
+
+        [[nodiscard]] bool is_mapped() const {
+            return mapped;
+        }
+
+        [[nodiscard]] const char* begin() const {
+            return data;
+        }
+
+        [[nodiscard]] const char* end() const {
+            return data + length;
+        }
+
+        [[nodiscard]] std::size_t size() const {
+            return length;
+        }
+
+    protected:
+        const char* data = nullptr;
+        std::size_t length = 0;
+        bool mapped = false;
+    };
+
+    /**
+     * An input stream over a memory-mapped file.
+     *
+     * Use like a std::ifstream. It can be passed to any read_matrix_market_* method. The header is read through
+     * the usual std::istream interface, then the body is parsed directly out of the page cache with no
+     * per-chunk copies.
+     *
+     * Compressed files (gzip, bzip2, zstd) are detected by their magic bytes and decompressed as they are read.
+     * See decompress_streambuf.
+     *
+     * If the file cannot be mapped this falls back to a regular std::filebuf.
+     */
+    class mapped_istream : public std::istream {
+    public:
+        explicit mapped_istream(const std::string& path, const read_options& options = {}) : std::istream(nullptr), file(path) {
+            if (file.is_mapped()) {
+                if (detect_compression(file.begin(), file.size()) == NoCompression) {
+                    membuf.set_range(file.begin(), file.end());
+                    rdbuf(&membuf);
+                } else {
+                    decompressor = std::make_unique<decompress_streambuf>(file.begin(), file.end(), options);
+                    rdbuf(decompressor.get());
+                    exceptions(std::ios_base::badbit);
+                }
+            } else {
+                if (filebuf.open(path, std::ios_base::in | std::ios_base::binary) == nullptr) {
+                    rdbuf(&filebuf);
+                    setstate(std::ios_base::failbit);
+                } else {
+                    // Cannot look ahead in a pipe, so always go through the decompressor. It passes through
+                    // uncompressed input.
+                    decompressor = std::make_unique<decompress_streambuf>(&filebuf, options);
+                    rdbuf(decompressor.get());
+                    exceptions(std::ios_base::badbit);
+                }
+            }
+        }
+
+        /**
+         * @return true if the file was opened, false otherwise.
+         */
+        [[nodiscard]] bool is_open() const {
+            return file.is_mapped() || filebuf.is_open();
+        }
+
+        /**
+         * @return true if the file is memory-mapped, false if the stream is using the std::filebuf fallback.
+         */
+        [[nodiscard]] bool is_mapped() const {
+            return file.is_mapped();
+        }
+
+        /**
+         * @return the compression of the file, or NoCompression.
+         */
+        [[nodiscard]] compression_type get_compression() const {
+            return decompressor ? decompressor->get_compression() : NoCompression;
+        }
+
+    protected:
+        mapped_file file;
+        memory_streambuf membuf;
+        std::filebuf filebuf;
+        std::unique_ptr<decompress_streambuf> decompressor;
+    };
+}
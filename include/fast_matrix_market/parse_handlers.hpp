@@ -4,11 +4,18 @@
 
 #pragma once
 
+#include <atomic>
+
 #include <algorithm>
 #include <complex>
+#include <deque>
 #include <functional>
 #include <iterator>
+#include <limits>
+#include <memory>
+#include <mutex>
 #include <type_traits>
+#include <vector>
 
 #include "fast_matrix_market.hpp"
 
@@ -35,6 +42,12 @@ namespace fast_matrix_market {
      */
     constexpr int kAppending = 4;
 
+    /**
+     * This parse handler takes each chunk's elements at once with handle_batch(), in file order and on the reading
+     * thread. It does not need handle() or get_chunk_handler(). Only supported by read_body_threads_fused().
+     */
+    constexpr int kChunkBatches = 8;
+
     /**
      * Tuple handler. A single vector of (row, column, value) tuples.
      */
@@ -273,4 +286,247 @@ namespace fast_matrix_market {
         int64_t nrows;
         int64_t ncols;
     };
-}
\ No newline at end of file
+
+    /**
+     * Buffers a chunk's elements in chunk-local storage, to be forwarded to another handler with replay().
+     *
+     * Used to parse a chunk before its offset into the final datastructure is known. FLAGS should match the flags
+     * of the handler that will receive the elements so that the same elements are emitted.
+     */
+    template<typename IT, typename VT, int FLAGS>
+    class chunk_buffer_parse_handler {
+    public:
+        using coordinate_type = IT;
+        using value_type = VT;
+        static constexpr int flags = FLAGS;
+
+        template <typename T>
+        void handle(const coordinate_type row, const coordinate_type col, const T& value) {
+            rows.push_back(row);
+            cols.push_back(col);
+            if constexpr (!std::is_same_v<T, pattern_placeholder_type>) {
+                values.push_back(value);
+            }
+        }
+
+        /**
+         * Forward all buffered elements to `handler`, in order.
+         */
+        template <typename HANDLER>
+        void replay(HANDLER& handler) const {
+            for (std::size_t i = 0; i < rows.size(); ++i) {
+                if (values.empty()) {
+                    handler.handle(rows[i], cols[i], pattern_placeholder_type());
+                } else {
+                    handler.handle(rows[i], cols[i], values[i]);
+                }
+            }
+        }
+
+        [[nodiscard]] std::size_t size() const {
+            return rows.size();
+        }
+
+        /**
+         * @return bytes allocated for buffered elements.
+         */
+        [[nodiscard]] std::size_t capacity_bytes() const {
+            return (rows.capacity() + cols.capacity()) * sizeof(coordinate_type) + values.capacity() * sizeof(value_type);
+        }
+
+        [[nodiscard]] const std::vector<coordinate_type>& get_rows() const {
+            return rows;
+        }
+
+        [[nodiscard]] const std::vector<coordinate_type>& get_cols() const {
+            return cols;
+        }
+
+        /**
+         * Empty if the elements are patterns.
+         */
+        [[nodiscard]] const std::vector<value_type>& get_values() const {
+            return values;
+        }
+
+        /**
+         * Remove all buffered elements but keep the allocated memory.
+         */
+        void clear() {
+            rows.clear();
+            cols.clear();
+            values.clear();
+        }
+
+    protected:
+        std::vector<coordinate_type> rows;
+        std::vector<coordinate_type> cols;
+        std::vector<value_type> values;
+    };
+
+    /**
+     * @return true if the options select a window of rows or columns. See read_options::filter_row_begin.
+     */
+    inline bool has_window_filter(const read_options& options) {
+        return options.filter_row_begin > 0 || options.filter_row_end >= 0 ||
+               options.filter_col_begin > 0 || options.filter_col_end >= 0;
+    }
+
+    /**
+     * Keeps only the elements that fall in a window of rows and columns. See read_options::filter_row_begin.
+     *
+     * Storage grows with the number of kept elements, not with the file's nnz. Each chunk handler keeps its
+     * elements in its own chunk_buffer_parse_handler. Once parsing is done, chunks() returns the buffers in file
+     * order.
+     *
+     * If `mirror` is set then an element is also kept if its transpose falls in the window. Use this when symmetry is
+     * generalized after the read.
+     *
+     * Thread safe.
+     */
+    template<typename IT, typename VT>
+    class window_filter_parse_handler {
+    public:
+        using coordinate_type = IT;
+        using value_type = VT;
+        static constexpr int flags = kParallelOk;
+
+        using buffer_type = chunk_buffer_parse_handler<IT, VT, flags>;
+
+        window_filter_parse_handler(const read_options& options, bool mirror) : shared(std::make_shared<shared_state>()), mirror(mirror) {
+            auto end_or_max = [](int64_t end) {
+                return end < 0 ? std::numeric_limits<int64_t>::max() : end;
+            };
+            row_begin = options.filter_row_begin;
+            row_end = end_or_max(options.filter_row_end);
+            col_begin = options.filter_col_begin;
+            col_end = end_or_max(options.filter_col_end);
+            buffer = shared->add_chunk(0);
+        }
+
+        template <typename T>
+        void handle(const coordinate_type row, const coordinate_type col, const T& value) {
+            if (in_window(row, col) || (mirror && in_window(col, row))) {
+                buffer->handle(row, col, value);
+            }
+        }
+
+        window_filter_parse_handler get_chunk_handler(int64_t offset_from_begin) {
+            window_filter_parse_handler chunk_handler = *this;
+            chunk_handler.buffer = shared->add_chunk(offset_from_begin);
+            return chunk_handler;
+        }
+
+        /**
+         * @return the buffered chunks in file order. Call once parsing is done.
+         */
+        [[nodiscard]] std::vector<const buffer_type*> chunks() const {
+            std::vector<std::pair<int64_t, const buffer_type*>> sorted;
+            for (const auto& [offset, chunk] : shared->chunks) {
+                sorted.emplace_back(offset, &chunk);
+            }
+            // Chunks with equal offsets follow chunks that had no elements.
+            std::stable_sort(sorted.begin(), sorted.end(),
+                             [](const auto& lhs, const auto& rhs) { return lhs.first < rhs.first; });
+
+            std::vector<const buffer_type*> ret;
+            for (const auto& [offset, chunk] : sorted) {
+                ret.push_back(chunk);
+            }
+            return ret;
+        }
+
+    protected:
+        [[nodiscard]] bool in_window(const coordinate_type row, const coordinate_type col) const {
+            return (int64_t)row >= row_begin && (int64_t)row < row_end && (int64_t)col >= col_begin && (int64_t)col < col_end;
+        }
+
+        struct shared_state {
+            std::mutex mutex;
+            // A deque so that buffers do not move as chunks are added.
+            std::deque<std::pair<int64_t, buffer_type>> chunks;
+
+            buffer_type* add_chunk(int64_t offset) {
+                std::lock_guard<std::mutex> lock(mutex);
+                chunks.emplace_back(offset, buffer_type());
+                return &chunks.back().second;
+            }
+        };
+
+        std::shared_ptr<shared_state> shared;
+        buffer_type* buffer = nullptr;
+        bool mirror;
+
+        int64_t row_begin = 0;
+        int64_t row_end = 0;
+        int64_t col_begin = 0;
+        int64_t col_end = 0;
+    };
+
+    /**
+     * First pass of reading into a compressed (CSR or CSC) format. Counts the elements in each row or column.
+     *
+     * Thread safe. All chunk handlers share the same counters.
+     */
+    template<typename IT, typename VT>
+    class compressed_count_parse_handler {
+    public:
+        using coordinate_type = IT;
+        using value_type = VT;
+        static constexpr int flags = kParallelOk | kAppending;
+
+        /**
+         * @param counts one counter per row (or column if `by_column`).
+         */
+        compressed_count_parse_handler(std::atomic<int64_t>* counts, bool by_column) : counts(counts), by_column(by_column) {}
+
+        void handle(const coordinate_type row, const coordinate_type col, [[maybe_unused]] const value_type& value) {
+            counts[by_column ? col : row].fetch_add(1, std::memory_order_relaxed);
+        }
+
+        compressed_count_parse_handler get_chunk_handler([[maybe_unused]] int64_t offset_from_begin) {
+            return *this;
+        }
+
+    protected:
+        std::atomic<int64_t>* counts;
+        bool by_column;
+    };
+
+    /**
+     * Second pass of reading into a compressed (CSR or CSC) format. Places each element into its row's (or column's)
+     * segment of the index and value arrays.
+     *
+     * Thread safe. Elements of a row are placed in arrival order, which is not deterministic with multiple threads.
+     */
+    template<typename IND_ITER, typename VT_ITER>
+    class compressed_scatter_parse_handler {
+    public:
+        using coordinate_type = typename std::iterator_traits<IND_ITER>::value_type;
+        using value_type = typename std::iterator_traits<VT_ITER>::value_type;
+        static constexpr int flags = kParallelOk | kAppending;
+
+        /**
+         * @param cursors one per row (or column if `by_column`). Initially the start of the row's segment.
+         */
+        compressed_scatter_parse_handler(std::atomic<int64_t>* cursors, bool by_column,
+                                         const IND_ITER& indices, const VT_ITER& values) :
+                                         cursors(cursors), by_column(by_column), indices(indices), values(values) {}
+
+        void handle(const coordinate_type row, const coordinate_type col, const value_type& value) {
+            auto pos = cursors[by_column ? col : row].fetch_add(1, std::memory_order_relaxed);
+            indices[pos] = by_column ? row : col;
+            values[pos] = value;
+        }
+
+        compressed_scatter_parse_handler get_chunk_handler([[maybe_unused]] int64_t offset_from_begin) {
+            return *this;
+        }
+
+    protected:
+        std::atomic<int64_t>* cursors;
+        bool by_column;
+        IND_ITER indices;
+        VT_ITER values;
+    };
+}
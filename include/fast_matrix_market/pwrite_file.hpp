@@ -0,0 +1,188 @@
+// Copyright (C) 2023 Adam Lugowski. All rights reserved.
+// Use of this source code is governed by the BSD 2-clause license found in the LICENSE.txt file.
+// SPDX-License-Identifier: BSD-2-Clause
+
+#pragma once
+
+#include <cerrno>
+#include <cstring>
+#include <fstream>
+#include <string>
+
+#if defined(__unix__) || defined(__APPLE__)
+#include <fcntl.h>
+#include <sys/types.h>
+#include <unistd.h>
+#define FMM_HAVE_PWRITE 1
+#endif
+
+#include "fast_matrix_market.hpp"
+
+namespace fast_matrix_market {
+
+#ifdef FMM_HAVE_PWRITE
+    /**
+     * A write-only stream buffer over a file descriptor that writes with pwrite().
+     *
+     * Sequential writes go through a small buffer. Callers may also write at explicit offsets with write_at(), which
+     * is safe to call from multiple threads concurrently as long as the byte ranges do not overlap.
+     */
+    class pwrite_streambuf : public std::streambuf {
+    public:
+        pwrite_streambuf() = default;
+
+        ~pwrite_streambuf() override {
+            close();
+        }
+
+        pwrite_streambuf(const pwrite_streambuf&) = delete;
+        pwrite_streambuf& operator=(const pwrite_streambuf&) = delete;
+
+        /**
+         * Open `path` for writing. Truncates any existing file.
+         *
+         * @return true on success
+         */
+        bool open(const std::string& path) {
+            fd = ::open(path.c_str(), O_WRONLY | O_CREAT | O_TRUNC, 0666);
+            position = 0;
+            setp(buffer, buffer + sizeof(buffer));
+            return fd >= 0;
+        }
+
+        [[nodiscard]] bool is_open() const {
+            return fd >= 0;
+        }
+
+        void close() {
+            if (fd >= 0) {
+                sync();
+                ::close(fd);
+                fd = -1;
+            }
+        }
+
+        /**
+         * @return the file offset where the next sequential write will land. Flushes the buffer.
+         */
+        int64_t tell() {
+            flush_buffer();
+            return position;
+        }
+
+        /**
+         * Move the sequential write position, such as past a body written with write_at(). Flushes the buffer.
+         */
+        void seek(int64_t offset) {
+            flush_buffer();
+            position = offset;
+        }
+
+        /**
+         * Write `size` bytes at `offset`. Does not touch the sequential write position.
+         *
+         * Thread safe for non-overlapping ranges.
+         */
+        void write_at(const char* data, std::size_t size, int64_t offset) const {
+            while (size > 0) {
+                ssize_t written = ::pwrite(fd, data, size, (off_t)offset);
+                if (written < 0) {
+                    if (errno == EINTR) {
+                        continue;
+                    }
+                    throw fmm_error(std::string("Error writing file: ") + std::strerror(errno));
+                }
+                data += written;
+                size -= (std::size_t)written;
+                offset += written;
+            }
+        }
+
+    protected:
+        int_type overflow(int_type ch) override {
+            if (!flush_buffer()) {
+                return traits_type::eof();
+            }
+            if (!traits_type::eq_int_type(ch, traits_type::eof())) {
+                *pptr() = traits_type::to_char_type(ch);
+                pbump(1);
+            }
+            return traits_type::not_eof(ch);
+        }
+
+        int sync() override {
+            return flush_buffer() ? 0 : -1;
+        }
+
+        bool flush_buffer() {
+            auto size = (std::size_t)(pptr() - pbase());
+            if (size > 0) {
+                try {
+                    write_at(pbase(), size, position);
+                } catch (const fmm_error&) {
+                    return false;
+                }
+                position += (int64_t)size;
+                setp(buffer, buffer + sizeof(buffer));
+            }
+            return true;
+        }
+
+        int fd = -1;
+        int64_t position = 0;
+        char buffer[1 << 14]{};
+    };
+#endif
+
+    /**
+     * An output file stream that lets the parallel writer write chunks concurrently.
+     *
+     * Use like a std::ofstream. When passed to any write_matrix_market_* method the header is written through the
+     * usual std::ostream interface, then worker threads write each formatted body chunk directly to its place in
+     * the file with pwrite(). There is no serial writer.
+     *
+     * On platforms without pwrite() this falls back to a regular std::filebuf.
+     */
+    class pwrite_ostream : public std::ostream {
+    public:
+        explicit pwrite_ostream(const std::string& path) : std::ostream(nullptr) {
+#ifdef FMM_HAVE_PWRITE
+            rdbuf(&pbuf);
+            if (!pbuf.open(path)) {
+                setstate(std::ios_base::failbit);
+            }
+#else
+            rdbuf(&filebuf);
+            if (filebuf.open(path, std::ios_base::out | std::ios_base::trunc | std::ios_base::binary) == nullptr) {
+                setstate(std::ios_base::failbit);
+            }
+#endif
+        }
+
+        /**
+         * @return true if the file was opened, false otherwise.
+         */
+        [[nodiscard]] bool is_open() const {
+#ifdef FMM_HAVE_PWRITE
+            return pbuf.is_open();
+#else
+            return filebuf.is_open();
+#endif
+        }
+
+        void close() {
+#ifdef FMM_HAVE_PWRITE
+            pbuf.close();
+#else
+            filebuf.close();
+#endif
+        }
+
+    protected:
+#ifdef FMM_HAVE_PWRITE
+        pwrite_streambuf pbuf;
+#else
+        std::filebuf filebuf;
+#endif
+    };
+}
@@ -209,40 +209,110 @@ namespace fast_matrix_market {
         }
     }
 
-    template<typename HANDLER>
-    line_counts read_chunk_matrix_coordinate(const std::string &chunk, const matrix_market_header &header,
+    /**
+     * Compile-time version of generalize_symmetry_coordinate().
+     */
+    template<symmetry_type SYMMETRY, typename HANDLER, typename IT, typename VT>
+    void generalize_symmetry_coordinate(HANDLER& handler,
+                                        const read_options &options,
+                                        const IT& row,
+                                        const IT& col,
+                                        const VT& value) {
+        if (col != row) {
+            if constexpr (SYMMETRY == symmetric) {
+                handler.handle(col, row, value);
+            } else if constexpr (SYMMETRY == skew_symmetric) {
+                if constexpr (!std::is_unsigned_v<typename HANDLER::value_type>) {
+                    handler.handle(col, row, negate(value));
+                } else {
+                    throw invalid_argument("Cannot load skew-symmetric matrix into unsigned value type.");
+                }
+            } else if constexpr (SYMMETRY == hermitian) {
+                handler.handle(col, row, complex_conjugate(value));
+            }
+        } else {
+            if constexpr (!test_flag(HANDLER::flags, kAppending)) {
+                switch (options.generalize_coordinate_diagnonal_values) {
+                    case read_options::ExtraZeroElement:
+                        handler.handle(row, col, get_zero<typename HANDLER::value_type>());
+                        break;
+                    case read_options::DuplicateElement:
+                        handler.handle(row, col, value);
+                        break;
+                }
+            }
+        }
+    }
+
+    /**
+     * Compile-time version of read_real_or_complex().
+     *
+     * @tparam COMPLEX_FIELD whether the file's field is complex. Only used if value_type is complex.
+     */
+    template <bool COMPLEX_FIELD, typename value_type>
+    const char* read_real_or_complex(value_type& value,
+                                     const char* pos,
+                                     const char* end,
+                                     const read_options &options) {
+        if constexpr (is_complex<value_type>::value && !COMPLEX_FIELD) {
+            typename value_type::value_type real;
+            pos = read_value(pos, end, real, options);
+            value.real(real);
+            value.imag(0);
+            return pos;
+        } else {
+            return read_value(pos, end, value, options);
+        }
+    }
+
+    /**
+     * Parse a chunk of a coordinate matrix body.
+     *
+     * This is the inner loop, so the file's field and symmetry are template parameters instead of runtime checks.
+     * See read_chunk_matrix_coordinate() for the dispatch.
+     *
+     * @tparam PATTERN whether the field is pattern, i.e. there is no value column.
+     * @tparam COMPLEX_FIELD whether the field is complex.
+     * @tparam GEN_SYMMETRY symmetry to generalize. `general` if not generalizing.
+     */
+    template<bool PATTERN, bool COMPLEX_FIELD, symmetry_type GEN_SYMMETRY, typename HANDLER>
+    line_counts read_chunk_matrix_coordinate(std::string_view chunk, const matrix_market_header &header,
                                              line_counts line, HANDLER &handler, const read_options &options) {
-        const char *pos = chunk.c_str();
+        const char *pos = chunk.data();
         const char *end = pos + chunk.size();
 
-        while (pos != end) {
-            try {
+        const auto nrows = header.nrows;
+        const auto ncols = header.ncols;
+        const auto nnz = header.nnz;
+
+        try {
+            while (pos != end) {
                 typename HANDLER::coordinate_type row, col;
                 typename HANDLER::value_type value;
 
-                pos = skip_spaces_and_newlines(pos, line.file_line);
+                pos = skip_spaces_and_newlines(pos, end, line.file_line);
                 if (pos == end) {
                     // empty line
                     break;
                 }
-                if (line.element_num >= header.nnz) {
+                if (line.element_num >= nnz) {
                     throw invalid_mm("Too many lines in file (file too long)");
                 }
 
                 pos = read_int(pos, end, row);
                 pos = skip_spaces(pos);
                 pos = read_int(pos, end, col);
-                if (header.field != pattern) {
+                if constexpr (!PATTERN) {
                     pos = skip_spaces(pos);
-                    read_real_or_complex(value, pos, end, header, options);
+                    pos = read_real_or_complex<COMPLEX_FIELD>(value, pos, end, options);
                 }
                 pos = bump_to_next_line(pos, end);
 
                 // validate
-                if (row <= 0 || static_cast<int64_t>(row) > header.nrows) {
+                if (row <= 0 || static_cast<int64_t>(row) > nrows) {
                     throw invalid_mm("Row index out of bounds");
                 }
-                if (col <= 0 || static_cast<int64_t>(col) > header.ncols) {
+                if (col <= 0 || static_cast<int64_t>(col) > ncols) {
                     throw invalid_mm("Column index out of bounds");
                 }
 
@@ -252,15 +322,15 @@ namespace fast_matrix_market {
 
                 // Generalize symmetry
                 // This appears before the regular handler call for ExtraZeroElement handling.
-                if (header.symmetry != general && options.generalize_symmetry) {
-                    if (header.field != pattern) {
-                        generalize_symmetry_coordinate(handler, header, options, row, col, value);
+                if constexpr (GEN_SYMMETRY != general) {
+                    if constexpr (!PATTERN) {
+                        generalize_symmetry_coordinate<GEN_SYMMETRY>(handler, options, row, col, value);
                     } else {
-                        generalize_symmetry_coordinate(handler, header, options, row, col, pattern_placeholder_type());
+                        generalize_symmetry_coordinate<GEN_SYMMETRY>(handler, options, row, col, pattern_placeholder_type());
                     }
                 }
 
-                if (header.field != pattern) {
+                if constexpr (!PATTERN) {
                     handler.handle(row, col, value);
                 } else {
                     handler.handle(row, col, pattern_placeholder_type());
@@ -268,50 +338,91 @@ namespace fast_matrix_market {
 
                 ++line.file_line;
                 ++line.element_num;
-            } catch (invalid_mm& inv) {
-                inv.prepend_line_number(line.file_line + 1);
-                throw;
             }
+        } catch (invalid_mm& inv) {
+            inv.prepend_line_number(line.file_line + 1);
+            throw;
         }
         return line;
     }
 
-#ifndef FMM_NO_VECTOR
+    /**
+     * Parse a chunk of a coordinate matrix body.
+     */
     template<typename HANDLER>
-    line_counts read_chunk_vector_coordinate(const std::string &chunk, const matrix_market_header &header,
+    line_counts read_chunk_matrix_coordinate(std::string_view chunk, const matrix_market_header &header,
+                                             line_counts line, HANDLER &handler, const read_options &options) {
+        // Only instantiate complex-field kernels if they can differ.
+        constexpr bool can_be_complex = is_complex<typename HANDLER::value_type>::value;
+        const symmetry_type gen_symmetry = options.generalize_symmetry ? header.symmetry : general;
+
+        auto dispatch_symmetry = [&](auto pattern, auto complex_field) {
+            constexpr bool P = decltype(pattern)::value;
+            constexpr bool C = decltype(complex_field)::value;
+            switch (gen_symmetry) {
+                case general:
+                    return read_chunk_matrix_coordinate<P, C, general>(chunk, header, line, handler, options);
+                case symmetric:
+                    return read_chunk_matrix_coordinate<P, C, symmetric>(chunk, header, line, handler, options);
+                case skew_symmetric:
+                    return read_chunk_matrix_coordinate<P, C, skew_symmetric>(chunk, header, line, handler, options);
+                case hermitian:
+                    return read_chunk_matrix_coordinate<P, C, hermitian>(chunk, header, line, handler, options);
+            }
+            return line;
+        };
+
+        if (header.field == pattern) {
+            return dispatch_symmetry(std::true_type{}, std::false_type{});
+        } else if (can_be_complex && header.field == complex) {
+            return dispatch_symmetry(std::false_type{}, std::bool_constant<can_be_complex>{});
+        } else {
+            return dispatch_symmetry(std::false_type{}, std::false_type{});
+        }
+    }
+
+#ifndef FMM_NO_VECTOR
+    /**
+     * Parse a chunk of a coordinate vector body. See the matrix version for the template parameters.
+     */
+    template<bool PATTERN, bool COMPLEX_FIELD, typename HANDLER>
+    line_counts read_chunk_vector_coordinate(std::string_view chunk, const matrix_market_header &header,
                                              line_counts line, HANDLER &handler, const read_options &options) {
-        const char *pos = chunk.c_str();
+        const char *pos = chunk.data();
         const char *end = pos + chunk.size();
 
-        while (pos != end) {
-            try {
+        const auto vector_length = header.vector_length;
+        const auto nnz = header.nnz;
+
+        try {
+            while (pos != end) {
                 typename HANDLER::coordinate_type row;
                 typename HANDLER::value_type value;
 
-                pos = skip_spaces_and_newlines(pos, line.file_line);
+                pos = skip_spaces_and_newlines(pos, end, line.file_line);
                 if (pos == end) {
                     // empty line
                     break;
                 }
-                if (line.element_num >= header.nnz) {
+                if (line.element_num >= nnz) {
                     throw invalid_mm("Too many lines in file (file too long)");
                 }
                 pos = read_int(pos, end, row);
-                if (header.field != pattern) {
+                if constexpr (!PATTERN) {
                     pos = skip_spaces(pos);
-                    read_real_or_complex(value, pos, end, header, options);
+                    pos = read_real_or_complex<COMPLEX_FIELD>(value, pos, end, options);
                 }
                 pos = bump_to_next_line(pos, end);
 
                 // validate
-                if (row <= 0 || static_cast<int64_t>(row) > header.vector_length) {
+                if (row <= 0 || static_cast<int64_t>(row) > vector_length) {
                     throw invalid_mm("Vector index out of bounds");
                 }
 
                 // Matrix Market is one-based
                 row = row - 1;
 
-                if (header.field != pattern) {
+                if constexpr (!PATTERN) {
                     handler.handle(row, 0, value);
                 } else {
                     handler.handle(row, 0, pattern_placeholder_type());
@@ -319,21 +430,38 @@ namespace fast_matrix_market {
 
                 ++line.file_line;
                 ++line.element_num;
-            } catch (invalid_mm& inv) {
-                inv.prepend_line_number(line.file_line + 1);
-                throw;
             }
+        } catch (invalid_mm& inv) {
+            inv.prepend_line_number(line.file_line + 1);
+            throw;
         }
         return line;
     }
+
+    /**
+     * Parse a chunk of a coordinate vector body.
+     */
+    template<typename HANDLER>
+    line_counts read_chunk_vector_coordinate(std::string_view chunk, const matrix_market_header &header,
+                                             line_counts line, HANDLER &handler, const read_options &options) {
+        constexpr bool can_be_complex = is_complex<typename HANDLER::value_type>::value;
+
+        if (header.field == pattern) {
+            return read_chunk_vector_coordinate<true, false>(chunk, header, line, handler, options);
+        } else if (can_be_complex && header.field == complex) {
+            return read_chunk_vector_coordinate<false, can_be_complex>(chunk, header, line, handler, options);
+        } else {
+            return read_chunk_vector_coordinate<false, false>(chunk, header, line, handler, options);
+        }
+    }
 #endif
 
     template<typename HANDLER>
-    line_counts read_chunk_array(const std::string &chunk, const matrix_market_header &header, line_counts line,
+    line_counts read_chunk_array(std::string_view chunk, const matrix_market_header &header, line_counts line,
                                  HANDLER &handler, const read_options &options,
                                  typename HANDLER::coordinate_type &row,
                                  typename HANDLER::coordinate_type &col) {
-        const char *pos = chunk.c_str();
+        const char *pos = chunk.data();
         const char *end = pos + chunk.size();
 
         if (header.symmetry == skew_symmetric) {
@@ -350,7 +478,7 @@ namespace fast_matrix_market {
             try {
                 typename HANDLER::value_type value;
 
-                pos = skip_spaces_and_newlines(pos, line.file_line);
+                pos = skip_spaces_and_newlines(pos, end, line.file_line);
                 if (pos == end) {
                     // empty line
                     break;
@@ -413,9 +541,14 @@ namespace fast_matrix_market {
                                                 HANDLER& handler, const read_options& options = {}) {
         line_counts lc{header.header_line_count, 0};
 
+        chunk_reader reader(instream, options);
+        std::string buffer;
+        progress_reporter progress(options);
+
         // Read the file in chunks
-        while (instream.good()) {
-            std::string chunk = get_next_chunk(instream, options);
+        while (reader.has_next()) {
+            std::string_view chunk = reader.next_chunk(buffer);
+            auto element_num = lc.element_num;
 
             // parse the chunk
             if (header.object == matrix) {
@@ -427,6 +560,7 @@ namespace fast_matrix_market {
                 lc = read_chunk_vector_coordinate(chunk, header, lc, handler, options);
 #endif
             }
+            progress.add_chunk((int64_t)chunk.size(), lc.element_num - element_num);
         }
 
         return lc;
@@ -441,12 +575,18 @@ namespace fast_matrix_market {
         typename HANDLER::coordinate_type row = 0;
         typename HANDLER::coordinate_type col = 0;
 
+        chunk_reader reader(instream, options);
+        std::string buffer;
+        progress_reporter progress(options);
+
         // Read the file in chunks
-        while (instream.good()) {
-            std::string chunk = get_next_chunk(instream, options);
+        while (reader.has_next()) {
+            std::string_view chunk = reader.next_chunk(buffer);
+            auto element_num = lc.element_num;
 
             // parse the chunk
             lc = read_chunk_array(chunk, header, lc, handler, options, row, col);
+            progress.add_chunk((int64_t)chunk.size(), lc.element_num - element_num);
         }
 
         return lc;
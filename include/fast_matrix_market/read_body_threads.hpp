@@ -4,19 +4,33 @@
 
 #pragma once
 
+#include <algorithm>
 #include <future>
 #include <queue>
 
 #include "fast_matrix_market.hpp"
-#include "thirdparty/task_thread_pool.hpp"
+#include "buffer_pool.hpp"
+#include "instrumentation.hpp"
+#include "thread_pool.hpp"
 
 namespace fast_matrix_market {
 
     struct line_count_result_s {
-        std::string chunk;
+        /**
+         * The chunk. Either a view into `buffer` or into the input's memory (see chunk_reader).
+         */
+        std::string_view chunk;
         line_counts counts;
 
-        explicit line_count_result_s(std::string && c): chunk(c) {}
+        /**
+         * Backing storage for chunks read out of a stream.
+         */
+        std::string buffer;
+
+        /**
+         * See inflight_budget.
+         */
+        int64_t charge = 0;
     };
 
     using line_count_result = std::shared_ptr<line_count_result_s>;
@@ -29,6 +43,239 @@ namespace fast_matrix_market {
         return lcr;
     }
 
+    /**
+     * A chunk parsed into chunk-local storage, see read_body_threads_fused().
+     */
+    template <typename HANDLER>
+    struct fused_chunk_result_s {
+        std::string_view chunk;
+        std::string buffer;
+
+        chunk_buffer_parse_handler<typename HANDLER::coordinate_type, typename HANDLER::value_type, HANDLER::flags> elements;
+
+        /**
+         * Line and element counts of this chunk alone.
+         */
+        line_counts counts;
+
+        /**
+         * Whether the chunk failed to parse. The error is reported by re-parsing with the chunk's true line numbers.
+         */
+        bool failed = false;
+
+        /**
+         * See inflight_budget.
+         */
+        int64_t charge = 0;
+
+        [[nodiscard]] int64_t capacity_bytes() const {
+            return (int64_t)(buffer.capacity() + elements.capacity_bytes());
+        }
+    };
+
+    /**
+     * Parse a coordinate chunk into chunk-local storage, without knowing the chunk's position in the file.
+     */
+    template <typename HANDLER, typename RESULT>
+    RESULT parse_chunk_fused(RESULT result, const matrix_market_header& header, const read_options& options) {
+        result->elements.clear();
+        result->failed = false;
+        try {
+            if (header.object == matrix) {
+                result->counts = read_chunk_matrix_coordinate(result->chunk, header, {0, 0}, result->elements, options);
+            } else {
+#ifndef FMM_NO_VECTOR
+                result->counts = read_chunk_vector_coordinate(result->chunk, header, {0, 0}, result->elements, options);
+#endif
+            }
+        } catch (invalid_mm&) {
+            result->failed = true;
+        }
+        return result;
+    }
+
+    /**
+     * Parallel coordinate body reader that counts and parses each chunk in a single pass.
+     *
+     * Pipeline:
+     * 1. Read chunk
+     * 2. Parse chunk into chunk-local storage. This also yields the chunk's line and element counts.
+     * 3. Once all preceding chunks are parsed, the chunk's offset is known. Copy its elements to the handler.
+     *
+     * Step 2 does not depend on any other chunk so parsing starts as soon as a chunk is read. Step 3 only touches
+     * already-parsed elements.
+     *
+     * Errors are detected in step 2, but a chunk's line numbers are only known in step 3. A failed chunk is parsed
+     * again with the correct line numbers to produce the error message.
+     *
+     * If the handler has the kChunkBatches flag then step 3 passes the chunk-local storage to handle_batch() instead.
+     */
+    template <typename HANDLER>
+    line_counts read_body_threads_fused(std::istream& instream, const matrix_market_header& header,
+                                        HANDLER& handler, const read_options& options = {}) {
+        using fused_chunk_result = std::shared_ptr<fused_chunk_result_s<HANDLER>>;
+
+        line_counts lc{header.header_line_count, 0};
+
+        // Declared before the pool so that it outlives the tasks that record into it.
+        pipeline_recorder recorder(options);
+        pipeline_recorder* rec = recorder.get();
+
+        std::queue<std::future<fused_chunk_result>> parse_futures;
+        std::queue<std::future<fused_chunk_result>> copy_futures;
+        scoped_thread_pool pool(options);
+        recorder.set_num_threads(pool.get_num_threads());
+        progress_reporter progress(options, &pool);
+
+        chunk_reader reader(instream, options);
+
+        // Memory-backed streams are split into byte ranges, as in read_body_threads().
+        const bool split_ranges = reader.is_memory_backed();
+        const std::string_view body = split_ranges ? reader.take_remaining() : std::string_view{};
+        const auto range_size = static_cast<std::size_t>(std::max(options.chunk_size_bytes, (int64_t)1));
+        const std::size_t num_ranges = (body.size() + range_size - 1) / range_size;
+        std::size_t next_range = 0;
+
+        auto has_next_chunk = [&]() {
+            return split_ranges ? next_range < num_ranges : reader.has_next();
+        };
+
+        // Find the next chunk and start parsing it.
+        auto start_next_chunk = [&](fused_chunk_result result) {
+            if (split_ranges) {
+                std::size_t range_index = next_range++;
+                parse_futures.push(pool.submit([=, &header, &options]() {
+                    stage_timer timer(rec, stage_parse);
+                    result->chunk = get_range_chunk(result->buffer, body, range_index, range_size);
+                    return parse_chunk_fused<HANDLER>(result, header, options);
+                }));
+            } else {
+                {
+                    stage_timer timer(rec, stage_read, false);
+                    result->chunk = reader.next_chunk(result->buffer);
+                }
+                parse_futures.push(pool.submit([=, &header, &options]() {
+                    stage_timer timer(rec, stage_parse);
+                    return parse_chunk_fused<HANDLER>(result, header, options);
+                }));
+            }
+        };
+
+        // Reuse the chunk result objects and their memory.
+        std::queue<fused_chunk_result> reuse_pool;
+
+        // Parsed elements usually take more memory than their text. The estimate grows once chunks are measured.
+        inflight_budget budget(options, split_ranges ? 0 : options.chunk_size_bytes);
+
+        // A chunk is done once its elements reach the handler.
+        auto recycle = [&](const fused_chunk_result& result) {
+            budget.update(result->charge, result->capacity_bytes());
+            reuse_pool.push(result);
+            progress.add_chunk((int64_t)result->chunk.size(), result->counts.element_num);
+        };
+
+        // Reuse a chunk object, or allocate a new one if the budget allows. Otherwise nullptr.
+        auto acquire_chunk = [&]() -> fused_chunk_result {
+            if (!reuse_pool.empty()) {
+                auto result = reuse_pool.front();
+                reuse_pool.pop();
+                return result;
+            }
+            if (!budget.has_room()) {
+                return nullptr;
+            }
+            auto result = std::make_shared<fused_chunk_result_s<HANDLER>>();
+            if (options.buffer_pool && !split_ranges) {
+                result->buffer = options.buffer_pool->acquire(options.chunk_size_bytes);
+            }
+            result->charge = budget.add();
+            return result;
+        };
+
+        int generalizing_symmetry_factor = (header.symmetry != general && options.generalize_symmetry) ? 2 : 1;
+
+        // Number of concurrent chunks available to work on. See read_body_threads().
+        const unsigned inflight_count = pool.get_num_threads() + 1;
+
+        while (true) {
+            // Keep chunks parsing.
+            while (parse_futures.size() < inflight_count && has_next_chunk()) {
+                fused_chunk_result result = acquire_chunk();
+                if (result) {
+                    start_next_chunk(result);
+                } else if (!copy_futures.empty()) {
+                    // Over budget. Wait for a copy to free up a chunk.
+                    recycle(recorder.get(copy_futures.front()));
+                    copy_futures.pop();
+                } else {
+                    // All chunks are already parsing.
+                    break;
+                }
+            }
+
+            if (parse_futures.empty()) {
+                break;
+            }
+
+            // Wait on any copies. This serves as backpressure.
+            while (!copy_futures.empty() && (is_ready(copy_futures.front()) || copy_futures.size() > inflight_count)) {
+                recycle(recorder.get(copy_futures.front()));
+                copy_futures.pop();
+            }
+
+            fused_chunk_result result = recorder.get(parse_futures.front());
+            parse_futures.pop();
+            recorder.add_chunk((int64_t)result->chunk.size());
+
+            if (result->failed || lc.element_num + result->counts.element_num > header.nnz) {
+                // Parse again with the true line numbers. This throws the error.
+                chunk_buffer_parse_handler<typename HANDLER::coordinate_type, typename HANDLER::value_type, HANDLER::flags> discard;
+                if (header.object == matrix) {
+                    read_chunk_matrix_coordinate(result->chunk, header, lc, discard, options);
+                } else {
+#ifndef FMM_NO_VECTOR
+                    read_chunk_vector_coordinate(result->chunk, header, lc, discard, options);
+#endif
+                }
+            }
+
+            if constexpr (test_flag(HANDLER::flags, kChunkBatches)) {
+                // Hand the parsed elements over as they are. The next chunks keep parsing meanwhile.
+                {
+                    stage_timer timer(rec, stage_copy, false);
+                    handler.handle_batch(result->elements);
+                }
+                recycle(result);
+            } else {
+                // Copy the parsed elements to their final position.
+                auto chunk_handler = handler.get_chunk_handler(lc.element_num * generalizing_symmetry_factor);
+                copy_futures.push(pool.submit([=]() mutable {
+                    stage_timer timer(rec, stage_copy);
+                    result->elements.replay(chunk_handler);
+                    return result;
+                }));
+            }
+
+            // Advance counts for next chunk
+            lc.file_line += result->counts.file_line;
+            lc.element_num += result->counts.element_num;
+        }
+
+        // Wait on any copies.
+        while (!copy_futures.empty()) {
+            recycle(recorder.get(copy_futures.front()));
+            copy_futures.pop();
+        }
+
+        if (options.buffer_pool) {
+            for (; !reuse_pool.empty(); reuse_pool.pop()) {
+                options.buffer_pool->release(std::move(reuse_pool.front()->buffer));
+            }
+        }
+
+        return lc;
+    }
+
     template <typename HANDLER, compile_format FORMAT = compile_all>
     line_counts read_body_threads(std::istream& instream, const matrix_market_header& header,
                                   HANDLER& handler, const read_options& options = {}) {
@@ -43,7 +290,12 @@ namespace fast_matrix_market {
          * 2. for coordinate files the line number determines the chunk's offset into the result arrays
          * 3. for error messages
          *
-         * Only the main threads performs I/O reads. Everything else is done by tasks in a thread pool.
+         * For streams, only the main threads performs I/O reads. Everything else is done by tasks in a thread pool.
+         *
+         * If the stream is memory-backed (such as a mapped_istream) the body is instead split up front into
+         * chunk_size_bytes byte ranges. Each line count task snaps its own range to line boundaries, so chunk
+         * discovery is done in parallel and the main thread only tracks the line count prefix sum.
+         * Chunks are parsed in place.
          *
          * The line count is fast, but we still spawn line count tasks. The futures for these tasks are saved in a
          * queue to be retrieved in order. This enables easy tracking of the line numbers of each chunk.
@@ -54,17 +306,103 @@ namespace fast_matrix_market {
          * The line count step is significantly faster than the parse step. As a form of backpressure we don't read
          * additional chunks if there are too many inflight chunks.
          */
+        if (options.fused_count_parse && header.format == coordinate) {
+            if constexpr ((FORMAT & compile_coordinate_only) == compile_coordinate_only) {
+#ifdef FMM_NO_VECTOR
+                if (header.object == vector) {
+                    throw no_vector_support("Vector Matrix Market files not supported.");
+                }
+#endif
+                return read_body_threads_fused(instream, header, handler, options);
+            } else {
+                throw support_not_selected("Matrix is coordinate but reading coordinate files not enabled for this method.");
+            }
+        }
+
         line_counts lc{header.header_line_count, 0};
 
+        // Declared before the pool so that it outlives the tasks that record into it.
+        pipeline_recorder recorder(options);
+        pipeline_recorder* rec = recorder.get();
+
         std::queue<std::future<line_count_result>> line_count_futures;
         std::queue<std::future<line_count_result>> parse_futures;
-        task_thread_pool::task_thread_pool pool(options.num_threads);
+        scoped_thread_pool pool(options);
+        recorder.set_num_threads(pool.get_num_threads());
+        progress_reporter progress(options, &pool);
+
+        chunk_reader reader(instream, options);
+
+        // Memory-backed streams are split into byte ranges.
+        const bool split_ranges = reader.is_memory_backed();
+        const std::string_view body = split_ranges ? reader.take_remaining() : std::string_view{};
+        const auto range_size = static_cast<std::size_t>(std::max(options.chunk_size_bytes, (int64_t)1));
+        const std::size_t num_ranges = (body.size() + range_size - 1) / range_size;
+        std::size_t next_range = 0;
+
+        auto has_next_chunk = [&]() {
+            return split_ranges ? next_range < num_ranges : reader.has_next();
+        };
+
+        // Find the next chunk and start its line count.
+        auto start_next_chunk = [&](line_count_result lcr) {
+            if (split_ranges) {
+                std::size_t range_index = next_range++;
+                line_count_futures.push(pool.submit([=]() {
+                    stage_timer timer(rec, stage_line_count);
+                    lcr->chunk = get_range_chunk(lcr->buffer, body, range_index, range_size);
+                    if (lcr->chunk.empty()) {
+                        // A line spanned this entire range. It is counted by the range it started in.
+                        lcr->counts = {0, 0};
+                        return lcr;
+                    }
+                    return count_chunk_lines(lcr);
+                }));
+            } else {
+                {
+                    stage_timer timer(rec, stage_read, false);
+                    lcr->chunk = reader.next_chunk(lcr->buffer);
+                }
+                line_count_futures.push(pool.submit([=]() {
+                    stage_timer timer(rec, stage_line_count);
+                    return count_chunk_lines(lcr);
+                }));
+            }
+        };
 
         // Reuse the line_count_result objects. Each chunk would otherwise allocate a new 1MB std::string.
         // The lifetime of these strings is relatively short, but some allocators do not immediately reuse the memory.
         // This object pool can reduce overall RSS memory usage in many cases.
         std::queue<line_count_result> lcr_reuse_pool;
 
+        // Chunks of memory-backed streams only copy the lines that straddle their range.
+        inflight_budget budget(options, split_ranges ? 0 : options.chunk_size_bytes);
+
+        // A chunk is done once it is parsed.
+        auto recycle = [&](const line_count_result& lcr) {
+            budget.update(lcr->charge, (int64_t)lcr->buffer.capacity());
+            lcr_reuse_pool.push(lcr);
+            progress.add_chunk((int64_t)lcr->chunk.size(), lcr->counts.element_num);
+        };
+
+        // Reuse a chunk object, or allocate a new one if the budget allows. Otherwise nullptr.
+        auto acquire_chunk = [&]() -> line_count_result {
+            if (!lcr_reuse_pool.empty()) {
+                auto lcr = lcr_reuse_pool.front();
+                lcr_reuse_pool.pop();
+                return lcr;
+            }
+            if (!budget.has_room()) {
+                return nullptr;
+            }
+            auto lcr = std::make_shared<line_count_result_s>();
+            if (options.buffer_pool && !split_ranges) {
+                lcr->buffer = options.buffer_pool->acquire(options.chunk_size_bytes);
+            }
+            lcr->charge = budget.add();
+            return lcr;
+        };
+
         int generalizing_symmetry_factor = (header.symmetry != general && options.generalize_symmetry) ? 2 : 1;
 
         // Number of concurrent chunks available to work on.
@@ -72,48 +410,53 @@ namespace fast_matrix_market {
         // Too many increases costs, such as storing chunk results in memory before they're written.
         const unsigned inflight_count = pool.get_num_threads() + 1;
 
-        // Start reading chunks and counting lines.
-        for (unsigned seed_i = 0; seed_i < inflight_count && instream.good(); ++seed_i) {
-            line_count_result lcr = std::make_shared<line_count_result_s>(get_next_chunk(instream, options));
-            line_count_futures.push(pool.submit(count_chunk_lines, lcr));
-        }
-
         // Read chunks in order, as they become available.
-        while (!line_count_futures.empty()) {
+        while (true) {
+            // Keep chunks reading and counting lines.
+            while (line_count_futures.size() < inflight_count && has_next_chunk()) {
+                line_count_result lcr = acquire_chunk();
+                if (lcr) {
+                    start_next_chunk(lcr);
+                } else if (!parse_futures.empty()) {
+                    // Over budget. Wait for a parse to free up a chunk.
+                    recycle(recorder.get(parse_futures.front()));
+                    parse_futures.pop();
+                } else {
+                    // All chunks are already counting lines.
+                    break;
+                }
+            }
+
+            if (line_count_futures.empty()) {
+                break;
+            }
 
             // Wait on any parse results. This serves as backpressure.
             while (!parse_futures.empty() && (is_ready(parse_futures.front()) || parse_futures.size() > inflight_count)) {
                 // This will throw any parse errors.
-                auto lcr_to_reuse = parse_futures.front().get();
+                recycle(recorder.get(parse_futures.front()));
                 parse_futures.pop();
-
-                // save the lcr struct to reuse the memory
-                lcr_reuse_pool.push(lcr_to_reuse);
             }
 
             // We are ready to start another parse task.
-            line_count_result lcr = line_count_futures.front().get();
+            line_count_result lcr = recorder.get(line_count_futures.front());
             line_count_futures.pop();
 
-            // Next chunk has finished line count. Start another to replace it.
-            if (instream.good()) {
-                line_count_result lcr_reuse;
-                // attempt to reuse the chunk string object from a previous chunk
-                if (lcr_reuse_pool.empty()) {
-                    lcr_reuse = std::make_shared<line_count_result_s>("");
-                } else {
-                    lcr_reuse = lcr_reuse_pool.front();
-                    lcr_reuse_pool.pop();
-                }
-
-                get_next_chunk(lcr_reuse->chunk, instream, options);
-                line_count_futures.push(pool.submit(count_chunk_lines, lcr_reuse));
+            if (split_ranges && lcr->chunk.empty()) {
+                recycle(lcr);
+                continue;
             }
 
             // Parse it.
             if (lc.element_num > header.nnz) {
+                // Errors in earlier chunks come first, as in the sequential reader.
+                while (!parse_futures.empty()) {
+                    parse_futures.front().get();
+                    parse_futures.pop();
+                }
                 throw invalid_mm("File too long", lc.file_line + 1);
             }
+            recorder.add_chunk((int64_t)lcr->chunk.size());
             auto chunk_handler = handler.get_chunk_handler(lc.element_num * generalizing_symmetry_factor);
             if (header.format == array) {
                 if constexpr ((FORMAT & compile_array_only) == compile_array_only) {
@@ -122,6 +465,7 @@ namespace fast_matrix_market {
                     typename HANDLER::coordinate_type col = static_cast<HANDLER::coordinate_type>(lc.element_num / header.nrows);
 
                     parse_futures.push(pool.submit([=]() mutable {
+                        stage_timer timer(rec, stage_parse);
                         read_chunk_array(lcr->chunk, header, lc, chunk_handler, options, row, col);
                         return lcr;
                     }));
@@ -131,6 +475,7 @@ namespace fast_matrix_market {
             } else if (header.object == matrix) {
                 if constexpr ((FORMAT & compile_coordinate_only) == compile_coordinate_only) {
                     parse_futures.push(pool.submit([=]() mutable {
+                        stage_timer timer(rec, stage_parse);
                         read_chunk_matrix_coordinate(lcr->chunk, header, lc, chunk_handler, options);
                         return lcr;
                     }));
@@ -142,6 +487,7 @@ namespace fast_matrix_market {
                 throw no_vector_support("Vector Matrix Market files not supported.");
 #else
                 parse_futures.push(pool.submit([=]() mutable {
+                    stage_timer timer(rec, stage_parse);
                     read_chunk_vector_coordinate(lcr->chunk, header, lc, chunk_handler, options);
                     return lcr;
                 }));
@@ -155,10 +501,16 @@ namespace fast_matrix_market {
 
         // Wait on any parse results. This will throw any parse errors.
         while (!parse_futures.empty()) {
-            parse_futures.front().get();
+            recycle(recorder.get(parse_futures.front()));
             parse_futures.pop();
         }
 
+        if (options.buffer_pool) {
+            for (; !lcr_reuse_pool.empty(); lcr_reuse_pool.pop()) {
+                options.buffer_pool->release(std::move(lcr_reuse_pool.front()->buffer));
+            }
+        }
+
         return lc;
     }
 }
@@ -0,0 +1,231 @@
+// Copyright (C) 2023 Adam Lugowski. All rights reserved.
+// Use of this source code is governed by the BSD 2-clause license found in the LICENSE.txt file.
+// SPDX-License-Identifier: BSD-2-Clause
+
+#pragma once
+
+#include <cstdint>
+#include <cstring>
+
+/**
+ * SIMD support.
+ *
+ * Kernels are selected as follows:
+ *  - x86-64: SSE2 is part of the base ISA so is always available. SSSE3 and AVX2 are compiled in with a function
+ *    target attribute (GCC, Clang) and selected at runtime if the CPU supports them.
+ *  - AArch64: NEON is part of the base ISA so is always available.
+ *  - Everything else uses portable scalar code.
+ *
+ * Define FMM_NO_SIMD to only use the scalar code.
+ */
+#ifndef FMM_NO_SIMD
+#if defined(__x86_64__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2) || defined(__SSE2__)
+#define FMM_SIMD_SSE2 1
+#include <emmintrin.h>
+#if defined(__AVX2__)
+#define FMM_SIMD_AVX2 1
+#define FMM_SIMD_AVX2_TARGET
+#include <immintrin.h>
+#elif (defined(__GNUC__) || defined(__clang__)) && !defined(__INTEL_COMPILER)
+#define FMM_SIMD_AVX2 1
+#define FMM_SIMD_AVX2_RUNTIME_DISPATCH 1
+#define FMM_SIMD_AVX2_TARGET __attribute__((target("avx2")))
+#include <immintrin.h>
+#endif
+#if defined(__SSSE3__)
+#define FMM_SIMD_SSSE3 1
+#define FMM_SIMD_SSSE3_TARGET
+#include <tmmintrin.h>
+#elif (defined(__GNUC__) || defined(__clang__)) && !defined(__INTEL_COMPILER)
+#define FMM_SIMD_SSSE3 1
+#define FMM_SIMD_SSSE3_RUNTIME_DISPATCH 1
+#define FMM_SIMD_SSSE3_TARGET __attribute__((target("ssse3")))
+#include <tmmintrin.h>
+#endif
+#elif defined(__aarch64__) || defined(_M_ARM64)
+#define FMM_SIMD_NEON 1
+#include <arm_neon.h>
+#endif
+#endif
+
+namespace fast_matrix_market::simd {
+
+    /**
+     * @return true if the CPU running this code supports AVX2.
+     */
+    inline bool cpu_has_avx2() {
+#if defined(FMM_SIMD_AVX2_RUNTIME_DISPATCH)
+        static const bool has_avx2 = [] {
+            __builtin_cpu_init();
+            return __builtin_cpu_supports("avx2") != 0;
+        }();
+        return has_avx2;
+#elif defined(FMM_SIMD_AVX2)
+        return true;
+#else
+        return false;
+#endif
+    }
+
+    /**
+     * @return true if the CPU running this code supports SSSE3.
+     */
+    inline bool cpu_has_ssse3() {
+#if defined(FMM_SIMD_SSSE3_RUNTIME_DISPATCH)
+        static const bool has_ssse3 = [] {
+            __builtin_cpu_init();
+            return __builtin_cpu_supports("ssse3") != 0;
+        }();
+        return has_ssse3;
+#elif defined(FMM_SIMD_SSSE3)
+        return true;
+#else
+        return false;
+#endif
+    }
+
+    /**
+     * Bitmasks of a 64-byte block, one bit per byte.
+     */
+    struct block_masks {
+        /**
+         * Bytes that are '\n'.
+         */
+        uint64_t newline;
+
+        /**
+         * Bytes that are not whitespace, i.e. not one of ' ', '\t', '\r', '\n'.
+         */
+        uint64_t content;
+    };
+
+#ifdef FMM_SIMD_SSE2
+    inline block_masks classify_block_sse2(const char* block) {
+        const __m128i nl = _mm_set1_epi8('\n');
+        const __m128i sp = _mm_set1_epi8(' ');
+        const __m128i tab = _mm_set1_epi8('\t');
+        const __m128i cr = _mm_set1_epi8('\r');
+
+        block_masks ret{0, 0};
+        for (int i = 0; i < 4; ++i) {
+            __m128i v = _mm_loadu_si128(reinterpret_cast<const __m128i*>(block + 16 * i));
+            __m128i is_nl = _mm_cmpeq_epi8(v, nl);
+            __m128i is_ws = _mm_or_si128(_mm_or_si128(is_nl, _mm_cmpeq_epi8(v, sp)),
+                                         _mm_or_si128(_mm_cmpeq_epi8(v, tab), _mm_cmpeq_epi8(v, cr)));
+            auto nl_bits = static_cast<uint64_t>(static_cast<uint32_t>(_mm_movemask_epi8(is_nl)) & 0xFFFFu);
+            auto ws_bits = static_cast<uint64_t>(static_cast<uint32_t>(_mm_movemask_epi8(is_ws)) & 0xFFFFu);
+            ret.newline |= nl_bits << (16 * i);
+            ret.content |= (~ws_bits & 0xFFFFu) << (16 * i);
+        }
+        return ret;
+    }
+#endif
+
+#ifdef FMM_SIMD_AVX2
+    FMM_SIMD_AVX2_TARGET inline block_masks classify_block_avx2(const char* block) {
+        const __m256i nl = _mm256_set1_epi8('\n');
+        const __m256i sp = _mm256_set1_epi8(' ');
+        const __m256i tab = _mm256_set1_epi8('\t');
+        const __m256i cr = _mm256_set1_epi8('\r');
+
+        block_masks ret{0, 0};
+        for (int i = 0; i < 2; ++i) {
+            __m256i v = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(block + 32 * i));
+            __m256i is_nl = _mm256_cmpeq_epi8(v, nl);
+            __m256i is_ws = _mm256_or_si256(_mm256_or_si256(is_nl, _mm256_cmpeq_epi8(v, sp)),
+                                            _mm256_or_si256(_mm256_cmpeq_epi8(v, tab), _mm256_cmpeq_epi8(v, cr)));
+            auto nl_bits = static_cast<uint64_t>(static_cast<uint32_t>(_mm256_movemask_epi8(is_nl)));
+            auto ws_bits = static_cast<uint64_t>(static_cast<uint32_t>(_mm256_movemask_epi8(is_ws)));
+            ret.newline |= nl_bits << (32 * i);
+            ret.content |= (~ws_bits & 0xFFFFFFFFu) << (32 * i);
+        }
+        return ret;
+    }
+#endif
+
+#ifdef FMM_SIMD_NEON
+    /**
+     * Equivalent of x86's movemask for four 16-byte comparison results.
+     */
+    inline uint64_t neon_movemask_64(uint8x16_t c0, uint8x16_t c1, uint8x16_t c2, uint8x16_t c3) {
+        const uint8x16_t bits = {1, 2, 4, 8, 16, 32, 64, 128, 1, 2, 4, 8, 16, 32, 64, 128};
+        uint8x16_t sum0 = vpaddq_u8(vandq_u8(c0, bits), vandq_u8(c1, bits));
+        uint8x16_t sum1 = vpaddq_u8(vandq_u8(c2, bits), vandq_u8(c3, bits));
+        sum0 = vpaddq_u8(sum0, sum1);
+        sum0 = vpaddq_u8(sum0, sum0);
+        return vgetq_lane_u64(vreinterpretq_u64_u8(sum0), 0);
+    }
+
+    inline block_masks classify_block_neon(const char* block) {
+        const uint8x16_t nl = vdupq_n_u8('\n');
+        const uint8x16_t sp = vdupq_n_u8(' ');
+        const uint8x16_t tab = vdupq_n_u8('\t');
+        const uint8x16_t cr = vdupq_n_u8('\r');
+
+        uint8x16_t is_nl[4];
+        uint8x16_t is_ws[4];
+        for (int i = 0; i < 4; ++i) {
+            uint8x16_t v = vld1q_u8(reinterpret_cast<const uint8_t*>(block + 16 * i));
+            is_nl[i] = vceqq_u8(v, nl);
+            is_ws[i] = vorrq_u8(vorrq_u8(is_nl[i], vceqq_u8(v, sp)), vorrq_u8(vceqq_u8(v, tab), vceqq_u8(v, cr)));
+        }
+
+        return {neon_movemask_64(is_nl[0], is_nl[1], is_nl[2], is_nl[3]),
+                ~neon_movemask_64(is_ws[0], is_ws[1], is_ws[2], is_ws[3])};
+    }
+#endif
+
+#ifdef FMM_SIMD_SSSE3
+    /**
+     * Shuffle masks that right-align the first `n` bytes of a 16-byte vector and zero the rest.
+     */
+    struct right_align_masks {
+        alignas(16) uint8_t masks[16][16]{};
+
+        constexpr right_align_masks() {
+            for (int n = 0; n < 16; ++n) {
+                for (int j = 0; j < 16; ++j) {
+                    masks[n][j] = j < 16 - n ? 0x80 : static_cast<uint8_t>(j - (16 - n));
+                }
+            }
+        }
+    };
+
+    /**
+     * Parse a run of decimal digits.
+     *
+     * Finds the run's length with vector compares then converts the digits with multiply-adds.
+     * Reads exactly 16 bytes starting at `pos`.
+     *
+     * @param value set to the parsed value if 1 to 15 digits are found
+     * @return the number of digits found. 16 means the run is at least 16 digits long and `value` is not set.
+     */
+    FMM_SIMD_SSSE3_TARGET inline int parse_digits_ssse3(const char* pos, uint64_t& value) {
+        static constexpr right_align_masks align;
+
+        __m128i v = _mm_loadu_si128(reinterpret_cast<const __m128i*>(pos));
+        __m128i digits = _mm_sub_epi8(v, _mm_set1_epi8('0'));
+        __m128i is_digit = _mm_cmpeq_epi8(_mm_min_epu8(digits, _mm_set1_epi8(9)), digits);
+
+        auto non_digits = ~static_cast<uint32_t>(_mm_movemask_epi8(is_digit));
+        int length = __builtin_ctz(non_digits | 0x10000u);
+        if (length == 0 || length == 16) {
+            return length;
+        }
+
+        // right-align so the last digit is in the ones place
+        digits = _mm_shuffle_epi8(digits, _mm_load_si128(reinterpret_cast<const __m128i*>(align.masks[length])));
+
+        // combine adjacent digits: 2, then 4, then 8 digits per lane
+        __m128i pairs = _mm_maddubs_epi16(digits, _mm_setr_epi8(10, 1, 10, 1, 10, 1, 10, 1, 10, 1, 10, 1, 10, 1, 10, 1));
+        __m128i quads = _mm_madd_epi16(pairs, _mm_setr_epi16(100, 1, 100, 1, 100, 1, 100, 1));
+        quads = _mm_packs_epi32(quads, quads);
+        __m128i octets = _mm_madd_epi16(quads, _mm_setr_epi16(10000, 1, 10000, 1, 10000, 1, 10000, 1));
+
+        auto high = static_cast<uint64_t>(static_cast<uint32_t>(_mm_cvtsi128_si32(octets)));
+        auto low = static_cast<uint64_t>(static_cast<uint32_t>(_mm_cvtsi128_si32(_mm_srli_si128(octets, 4))));
+        value = high * 100000000 + low;
+        return length;
+    }
+#endif
+}
@@ -0,0 +1,206 @@
+// Copyright (C) 2023 Adam Lugowski. All rights reserved.
+// Use of this source code is governed by the BSD 2-clause license found in the LICENSE.txt file.
+// SPDX-License-Identifier: BSD-2-Clause
+
+#pragma once
+
+#include <algorithm>
+#include <atomic>
+#include <future>
+#include <memory>
+#include <thread>
+
+#include "fast_matrix_market.hpp"
+#include "thirdparty/task_thread_pool.hpp"
+#include "work_stealing_pool.hpp"
+
+namespace fast_matrix_market {
+
+    /**
+     * Library-wide thread pool with one thread per core.
+     *
+     * Created on first use and shared by all read and write calls that do not request a specific number of threads.
+     * Reusing warm threads avoids thread startup and teardown costs on every call, which dominate for small files.
+     */
+    inline task_thread_pool::task_thread_pool& default_thread_pool() {
+        static task_thread_pool::task_thread_pool pool;
+        return pool;
+    }
+
+    /**
+     * Library-wide work-stealing thread pool with one thread per core. See default_thread_pool().
+     */
+    inline work_stealing_thread_pool& default_work_stealing_thread_pool() {
+        static work_stealing_thread_pool pool;
+        return pool;
+    }
+
+    /**
+     * The thread pool that a single read or write call submits its tasks to.
+     *
+     * Uses, in order of preference:
+     *  - options.thread_pool, if set.
+     *  - default_thread_pool() or default_work_stealing_thread_pool(), depending on options.pool_type, if
+     *    options.num_threads is 0.
+     *  - A new pool of options.pool_type with options.num_threads threads, owned by this object.
+     *
+     * The destructor waits for every task submitted through this object, even if the pool is shared. This way
+     * tasks may safely refer to the caller's locals even if the call exits with an exception.
+     */
+    class scoped_thread_pool {
+    public:
+        template <typename OPTIONS>
+        explicit scoped_thread_pool(const OPTIONS& options) : shared(options.thread_pool) {
+            if (shared) {
+                pool = shared.get();
+            } else if (options.pool_type == WorkStealingPool) {
+                if (options.num_threads == 0) {
+                    stealing_pool = &default_work_stealing_thread_pool();
+                } else {
+                    owned_stealing = std::make_unique<work_stealing_thread_pool>(options.num_threads);
+                    stealing_pool = owned_stealing.get();
+                }
+            } else if (options.num_threads == 0) {
+                pool = &default_thread_pool();
+            } else {
+                owned = std::make_unique<task_thread_pool::task_thread_pool>(options.num_threads);
+                pool = owned.get();
+            }
+        }
+
+        ~scoped_thread_pool() {
+            // Normally only the tail of each task is left by the time the caller is done with the results.
+            while (outstanding.load(std::memory_order_acquire) != 0) {
+                std::this_thread::yield();
+            }
+        }
+
+        scoped_thread_pool(const scoped_thread_pool&) = delete;
+        scoped_thread_pool& operator=(const scoped_thread_pool&) = delete;
+
+        /**
+         * Same as task_thread_pool::submit().
+         */
+        template <typename F, typename... A,
+            typename R = std::invoke_result_t<std::decay_t<F>, std::decay_t<A>...>>
+        [[nodiscard]] std::future<R> submit(F&& func, A&&... args) {
+            auto ptask = std::make_shared<std::packaged_task<R()>>(std::bind(std::forward<F>(func), std::forward<A>(args)...));
+            outstanding.fetch_add(1, std::memory_order_relaxed);
+            auto task = [this, ptask]() mutable {
+                // packaged_task captures exceptions, so this always runs.
+                if (!cancelled.load(std::memory_order_relaxed)) {
+                    (*ptask)();
+                }
+
+                // A skipped task's future reports broken_promise. Release it before `this` may go away.
+                ptask.reset();
+
+                // Must be the last use of `this`.
+                outstanding.fetch_sub(1, std::memory_order_release);
+            };
+            if (stealing_pool != nullptr) {
+                stealing_pool->submit_detach(std::move(task));
+            } else {
+                pool->submit_detach(std::move(task));
+            }
+            return ptask->get_future();
+        }
+
+        [[nodiscard]] unsigned int get_num_threads() const {
+            return stealing_pool != nullptr ? stealing_pool->get_num_threads() : pool->get_num_threads();
+        }
+
+        /**
+         * Skip the tasks submitted through this object that have not started yet. Running tasks finish.
+         *
+         * Unlike task_thread_pool::clear_task_queue() this leaves other users' tasks in a shared pool alone.
+         */
+        void cancel() {
+            cancelled.store(true, std::memory_order_relaxed);
+        }
+
+    protected:
+        std::shared_ptr<task_thread_pool::task_thread_pool> shared;
+        std::unique_ptr<task_thread_pool::task_thread_pool> owned;
+        task_thread_pool::task_thread_pool* pool = nullptr;
+        std::unique_ptr<work_stealing_thread_pool> owned_stealing;
+        work_stealing_thread_pool* stealing_pool = nullptr;
+
+        std::atomic<std::size_t> outstanding{0};
+        std::atomic<bool> cancelled{false};
+    };
+
+    /**
+     * Accounts for the memory held by a pipeline's chunks against read_options::max_inflight_bytes or
+     * write_options::max_inflight_bytes. Used only by the pipeline's main thread.
+     *
+     * A new chunk is charged the size of the largest chunk seen so far. Its charge is updated to its actual size
+     * once it returns to the main thread.
+     */
+    class inflight_budget {
+    public:
+        /**
+         * @param initial_estimate expected size of a chunk, or 0 if unknown.
+         */
+        template <typename OPTIONS>
+        inflight_budget(const OPTIONS& options, int64_t initial_estimate) :
+            max_bytes(options.max_inflight_bytes), stats(options.stats), estimate(initial_estimate),
+            estimate_known(initial_estimate > 0) {}
+
+        ~inflight_budget() {
+            if (stats) {
+                stats->peak_inflight_bytes = std::max(stats->peak_inflight_bytes, peak);
+            }
+        }
+
+        inflight_budget(const inflight_budget&) = delete;
+        inflight_budget& operator=(const inflight_budget&) = delete;
+
+        /**
+         * @return whether another chunk may be put in flight. Always true if none are.
+         */
+        [[nodiscard]] bool has_room() const {
+            if (max_bytes <= 0 || num_chunks == 0) {
+                return true;
+            }
+            // Chunks of unknown size are put in flight one at a time until one is measured.
+            return estimate_known && held + estimate <= max_bytes;
+        }
+
+        /**
+         * Charge a new chunk.
+         * @return the chunk's charge. Pass to update() and remove().
+         */
+        int64_t add() {
+            ++num_chunks;
+            held += estimate;
+            peak = std::max(peak, held);
+            return estimate;
+        }
+
+        /**
+         * A chunk's actual size is known.
+         */
+        void update(int64_t& charge, int64_t bytes) {
+            held += bytes - charge;
+            charge = bytes;
+            estimate = std::max(estimate, bytes);
+            estimate_known = true;
+            peak = std::max(peak, held);
+        }
+
+        void remove(int64_t charge) {
+            --num_chunks;
+            held -= charge;
+        }
+
+    protected:
+        int64_t max_bytes;
+        std::shared_ptr<pipeline_stats> stats;
+        int64_t estimate;
+        bool estimate_known;
+        int64_t held = 0;
+        int64_t peak = 0;
+        int64_t num_chunks = 0;
+    };
+}
@@ -7,9 +7,16 @@
 #include <complex>
 #include <map>
 #include <cstdint>
+#include <functional>
+#include <memory>
 #include <string>
 
+namespace task_thread_pool {
+    class task_thread_pool;
+}
+
 namespace fast_matrix_market {
+    class chunk_buffer_pool;
 
     enum object_type {matrix, vector};
     const std::map<object_type, const std::string> object_map = {
@@ -74,6 +81,106 @@ namespace fast_matrix_market {
     enum storage_order {row_major = 1, col_major = 2};
     enum out_of_range_behavior {BestMatch = 1, ThrowOutOfRange = 2};
 
+    enum thread_pool_type {FifoPool, WorkStealingPool};
+    enum value_precision {DoublePrecision, SinglePrecision};
+
+    /**
+     * Stages of the read and write pipelines. See pipeline_stats.
+     *  - read: reading a chunk from the input stream.
+     *  - line_count: counting a chunk's lines.
+     *  - parse: parsing a chunk.
+     *  - copy: copying a parsed chunk to its destination, or passing it to a batch callback.
+     *  - generalize_symmetry: generalizing symmetry after the read, in the application binding.
+     *  - convert: converting the parsed elements to the final data structure, such as a CSR matrix.
+     *  - format: formatting a chunk for writing, including compression.
+     *  - write: writing a formatted chunk to the output.
+     */
+    enum pipeline_stage {stage_read, stage_line_count, stage_parse, stage_copy, stage_generalize_symmetry,
+                         stage_convert, stage_format, stage_write, kNumPipelineStages};
+    const std::map<pipeline_stage, const std::string> pipeline_stage_map = {
+            {stage_read, "read"},
+            {stage_line_count, "line_count"},
+            {stage_parse, "parse"},
+            {stage_copy, "copy"},
+            {stage_generalize_symmetry, "generalize_symmetry"},
+            {stage_convert, "convert"},
+            {stage_format, "format"},
+            {stage_write, "write"},
+    };
+
+    struct stage_stats {
+        /**
+         * Number of times the stage ran, usually once per chunk.
+         */
+        int64_t count = 0;
+
+        /**
+         * Wall and CPU time summed over all runs, in nanoseconds. CPU time is 0 where the platform cannot measure
+         * per-thread CPU time.
+         */
+        int64_t wall_ns = 0;
+        int64_t cpu_ns = 0;
+    };
+
+    /**
+     * Measurements of reads or writes. See read_options::stats.
+     *
+     * Measurements add up over all calls that use the same stats, except peak_inflight_bytes which is a maximum.
+     */
+    struct pipeline_stats {
+        stage_stats stages[kNumPipelineStages];
+
+        /**
+         * Wall time of the parallel pipelines, in nanoseconds.
+         */
+        int64_t wall_ns = 0;
+
+        /**
+         * Body bytes read or written by the parallel pipelines, and the number of chunks they were split into.
+         */
+        int64_t bytes = 0;
+        int64_t chunks = 0;
+
+        /**
+         * Number of times the main thread waited for a worker, such as to apply backpressure, and the total wait.
+         */
+        int64_t stalls = 0;
+        int64_t stall_ns = 0;
+
+        /**
+         * Time the pool's worker threads were not running a pipeline task, summed over workers.
+         */
+        int64_t worker_idle_ns = 0;
+
+        /**
+         * Largest total size of the chunk buffers held by a parallel pipeline at one time, in bytes.
+         * Buffer sizes are measured as chunks return to the main thread.
+         */
+        int64_t peak_inflight_bytes = 0;
+    };
+
+    /**
+     * Totals of a read or write so far. See read_options::progress_callback.
+     */
+    struct progress_info {
+        /**
+         * Body bytes processed. Reads count uncompressed text, writes count the bytes written to the output stream.
+         */
+        int64_t bytes = 0;
+
+        /**
+         * Elements (body lines) processed.
+         */
+        int64_t elements = 0;
+
+        int64_t chunks = 0;
+    };
+
+    /**
+     * Return false to cancel. See read_options::progress_callback.
+     */
+    using progress_callback_type = std::function<bool(const progress_info&)>;
+
     struct read_options {
         /**
          * Chunk size for the parsing step, in bytes.
@@ -117,9 +224,90 @@ namespace fast_matrix_market {
 
         /**
          * Number of threads to use. 0 means std::thread::hardware_concurrency().
+         *
+         * With 0 the work runs on the library-wide default_thread_pool(), which is created on first use and reused by
+         * later calls. Other values create a new pool of that size for each call.
          */
         int num_threads = 0;
 
+        /**
+         * Externally owned thread pool to run the parallel work on instead of the one chosen by num_threads.
+         * Use to share threads with the rest of an application.
+         *
+         * Do not call read or write methods from a task running on the same pool, as they wait on the tasks they submit.
+         */
+        std::shared_ptr<task_thread_pool::task_thread_pool> thread_pool;
+
+        /**
+         * Thread pool implementation to use if thread_pool is not set.
+         *  - FifoPool: task_thread_pool. A single task queue.
+         *  - WorkStealingPool: work_stealing_thread_pool. A deque per worker, which avoids contention on a single
+         *    queue lock with many threads and small chunks.
+         */
+        thread_pool_type pool_type = FifoPool;
+
+        /**
+         * Limit on the memory held by the chunks in flight in the parallel pipelines, in bytes. 0 means no limit
+         * beyond the default of about one chunk per thread.
+         *
+         * Chunk buffers are only allocated while the total stays within the budget. One chunk is always allowed, so
+         * a budget smaller than one chunk makes the read sequential.
+         */
+        int64_t max_inflight_bytes = 0;
+
+        /**
+         * If set, reads record measurements here. See pipeline_stats. Do not share between concurrent reads.
+         */
+        std::shared_ptr<pipeline_stats> stats;
+
+        /**
+         * If set, called on the calling thread each time a chunk has been read, with the totals so far.
+         * Return false to cancel the read. Chunks not yet started are skipped and the read throws
+         * operation_cancelled.
+         *
+         * Reads that parse the body twice, such as CSR and CSC reads, report each pass.
+         */
+        progress_callback_type progress_callback;
+
+        /**
+         * Pool to take chunk buffers from and return them to. Share one between calls, and with write_options,
+         * to avoid allocating chunk buffers for every call. If not set, buffers are only reused within a call.
+         */
+        std::shared_ptr<chunk_buffer_pool> buffer_pool;
+
+        /**
+         * Coordinate files only. If true, the parallel reader parses each chunk in a single pass into chunk-local
+         * storage instead of first counting the chunk's lines to find its offset. The parsed elements are copied
+         * to their final position once the element counts of all preceding chunks are known.
+         *
+         * This takes line counting off the critical path at the cost of buffering each inflight parsed chunk.
+         */
+        bool fused_count_parse = false;
+
+        /**
+         * Path readers only (triplet, CSR, CSC). If true, the first read of a file writes a binary image of the
+         * parsed body next to it (see binary_cache_path()). Later reads of the same unchanged file map that image
+         * instead of parsing the text.
+         *
+         * The cache is keyed by the file's size, modification time, and a hash of its first and last 64 KiB, and by
+         * the index and value types read into. It is ignored if generalize_symmetry is set without
+         * generalize_symmetry_app, or if a filter window is set.
+         */
+        bool binary_cache = false;
+
+        /**
+         * Triplet reads only. Keep only the elements with a row in [filter_row_begin, filter_row_end) and a column
+         * in [filter_col_begin, filter_col_end). Indices are 0-based. An end of -1 means no limit.
+         *
+         * Elements outside the window are dropped as they are parsed, so memory is proportional to the number of
+         * elements kept rather than to the file's nnz. Symmetry is generalized before the window is applied, so
+         * a mirrored element is kept if it falls in the window. Diagonal elements are not duplicated.
+         */
+        int64_t filter_row_begin = 0;
+        int64_t filter_row_end = -1;
+        int64_t filter_col_begin = 0;
+        int64_t filter_col_end = -1;
+
         /**
          * How to handle floating-point values that do not fit into their declared type.
          * For example, parsing 1e9999 will
@@ -139,9 +327,53 @@ namespace fast_matrix_market {
 
         /**
          * Number of threads to use. 0 means std::thread::hardware_concurrency().
+         *
+         * With 0 the work runs on the library-wide default_thread_pool(), which is created on first use and reused by
+         * later calls. Other values create a new pool of that size for each call.
          */
         int num_threads = 0;
 
+        /**
+         * Externally owned thread pool to run the parallel work on instead of the one chosen by num_threads.
+         * Use to share threads with the rest of an application.
+         *
+         * Do not call read or write methods from a task running on the same pool, as they wait on the tasks they submit.
+         */
+        std::shared_ptr<task_thread_pool::task_thread_pool> thread_pool;
+
+        /**
+         * Thread pool implementation to use if thread_pool is not set.
+         *  - FifoPool: task_thread_pool. A single task queue.
+         *  - WorkStealingPool: work_stealing_thread_pool. A deque per worker, which avoids contention on a single
+         *    queue lock with many threads and small chunks.
+         */
+        thread_pool_type pool_type = FifoPool;
+
+        /**
+         * Limit on the memory held by the chunks in flight in the parallel pipelines, in bytes. 0 means no limit
+         * beyond the default of about one chunk per thread.
+         *
+         * Chunk buffers are only allocated while the total stays within the budget. One chunk is always allowed, so
+         * a budget smaller than one chunk makes the write sequential.
+         */
+        int64_t max_inflight_bytes = 0;
+
+        /**
+         * If set, writes record measurements here. See pipeline_stats. Do not share between concurrent writes.
+         */
+        std::shared_ptr<pipeline_stats> stats;
+
+        /**
+         * If set, called on the calling thread each time a chunk has been written, with the totals so far.
+         * Return false to cancel the write. See read_options::progress_callback.
+         */
+        progress_callback_type progress_callback;
+
+        /**
+         * Pool to take chunk buffers from and return them to. See read_options::buffer_pool.
+         */
+        std::shared_ptr<chunk_buffer_pool> buffer_pool;
+
         /**
          * Floating-point formatting precision.
          * Placeholder. Currently not used due to the various supported float rendering backends.
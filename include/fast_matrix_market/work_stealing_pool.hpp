@@ -0,0 +1,321 @@
+// Copyright (C) 2023 Adam Lugowski. All rights reserved.
+// Use of this source code is governed by the BSD 2-clause license found in the LICENSE.txt file.
+// SPDX-License-Identifier: BSD-2-Clause
+
+#pragma once
+
+#include <atomic>
+#include <condition_variable>
+#include <functional>
+#include <future>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+namespace fast_matrix_market {
+
+    /**
+     * Chase-Lev work-stealing deque.
+     *
+     * The owning worker pushes and pops at the bottom. Any other thread may steal from the top without locking.
+     * See Lê, Pop, Cohen, Zappa Nardelli, "Correct and Efficient Work-Stealing for Weak Memory Models", PPoPP 2013.
+     */
+    template <typename T>
+    class work_stealing_deque {
+    public:
+        explicit work_stealing_deque(std::size_t log_capacity = 6) {
+            rings.push_back(std::make_unique<ring>(log_capacity));
+            active.store(rings.back().get(), std::memory_order_relaxed);
+        }
+
+        work_stealing_deque(const work_stealing_deque&) = delete;
+        work_stealing_deque& operator=(const work_stealing_deque&) = delete;
+
+        /**
+         * Owner only.
+         */
+        void push(T item) {
+            int64_t b = bottom.load(std::memory_order_relaxed);
+            int64_t t = top.load(std::memory_order_acquire);
+            ring* r = active.load(std::memory_order_relaxed);
+            if (b - t > (int64_t)r->mask) {
+                r = grow(r, t, b);
+            }
+            r->put(b, item);
+            std::atomic_thread_fence(std::memory_order_release);
+            bottom.store(b + 1, std::memory_order_relaxed);
+        }
+
+        /**
+         * Owner only.
+         *
+         * @return the most recently pushed item, or a default-constructed T if empty.
+         */
+        T pop() {
+            int64_t b = bottom.load(std::memory_order_relaxed) - 1;
+            ring* r = active.load(std::memory_order_relaxed);
+            bottom.store(b, std::memory_order_relaxed);
+            std::atomic_thread_fence(std::memory_order_seq_cst);
+            int64_t t = top.load(std::memory_order_relaxed);
+
+            T item{};
+            if (t <= b) {
+                item = r->get(b);
+                if (t == b) {
+                    // Last item. Race against thieves for it.
+                    if (!top.compare_exchange_strong(t, t + 1, std::memory_order_seq_cst, std::memory_order_relaxed)) {
+                        item = T{};
+                    }
+                    bottom.store(b + 1, std::memory_order_relaxed);
+                }
+            } else {
+                bottom.store(b + 1, std::memory_order_relaxed);
+            }
+            return item;
+        }
+
+        /**
+         * Any thread.
+         *
+         * @return the least recently pushed item, or a default-constructed T if empty or if another thread won the race.
+         */
+        T steal() {
+            int64_t t = top.load(std::memory_order_acquire);
+            std::atomic_thread_fence(std::memory_order_seq_cst);
+            int64_t b = bottom.load(std::memory_order_acquire);
+
+            if (t < b) {
+                ring* r = active.load(std::memory_order_acquire);
+                T item = r->get(t);
+                if (top.compare_exchange_strong(t, t + 1, std::memory_order_seq_cst, std::memory_order_relaxed)) {
+                    return item;
+                }
+            }
+            return T{};
+        }
+
+    protected:
+        struct ring {
+            explicit ring(std::size_t log_capacity) : mask(((std::size_t)1 << log_capacity) - 1),
+                                                      items(new std::atomic<T>[(std::size_t)1 << log_capacity]) {}
+
+            T get(int64_t i) const {
+                return items[(std::size_t)i & mask].load(std::memory_order_relaxed);
+            }
+
+            void put(int64_t i, T item) {
+                items[(std::size_t)i & mask].store(item, std::memory_order_relaxed);
+            }
+
+            std::size_t mask;
+            std::unique_ptr<std::atomic<T>[]> items;
+        };
+
+        ring* grow(ring* old, int64_t t, int64_t b) {
+            std::size_t log_capacity = 1;
+            while (((std::size_t)1 << log_capacity) <= old->mask + 1) {
+                ++log_capacity;
+            }
+            rings.push_back(std::make_unique<ring>(log_capacity));
+            ring* r = rings.back().get();
+            for (int64_t i = t; i < b; ++i) {
+                r->put(i, old->get(i));
+            }
+            // Thieves may still be reading the old ring, so it is kept alive until the deque is destroyed.
+            active.store(r, std::memory_order_release);
+            return r;
+        }
+
+        alignas(64) std::atomic<int64_t> top{0};
+        alignas(64) std::atomic<int64_t> bottom{0};
+        std::atomic<ring*> active{nullptr};
+        std::vector<std::unique_ptr<ring>> rings;
+    };
+
+    /**
+     * A thread pool with a work-stealing deque per worker.
+     *
+     * Unlike task_thread_pool there is no single task queue that every submit and every worker contends on:
+     *  - Submissions from outside the pool are spread round-robin over per-worker inboxes.
+     *  - A worker moves its inbox into its own deque once the deque is empty, then runs those tasks oldest first.
+     *  - Idle workers steal from the other workers' deques without locking.
+     *  - The only shared lock is taken to put idle workers to sleep and to wake them.
+     *
+     * A worker only runs tasks from its own deque in submission order. Tasks may therefore wait on tasks submitted
+     * before them, as with a FIFO pool.
+     *
+     * Drop-in for the parts of task_thread_pool used by this library.
+     */
+    class work_stealing_thread_pool {
+    public:
+        explicit work_stealing_thread_pool(unsigned int num_threads = 0) {
+            if (num_threads < 1) {
+                num_threads = std::thread::hardware_concurrency();
+                if (num_threads < 1) { num_threads = 1; }
+            }
+
+            workers.reserve(num_threads);
+            for (unsigned int i = 0; i < num_threads; ++i) {
+                workers.push_back(std::make_unique<worker>());
+            }
+            threads.reserve(num_threads);
+            for (unsigned int i = 0; i < num_threads; ++i) {
+                threads.emplace_back([this, i] { worker_main(i); });
+            }
+        }
+
+        /**
+         * Finish all submitted tasks then shut down worker threads.
+         */
+        ~work_stealing_thread_pool() {
+            {
+                std::lock_guard<std::mutex> lock(sleep_mutex);
+                stopping = true;
+            }
+            sleep_cv.notify_all();
+            for (auto& thread : threads) {
+                thread.join();
+            }
+        }
+
+        work_stealing_thread_pool(const work_stealing_thread_pool&) = delete;
+        work_stealing_thread_pool& operator=(const work_stealing_thread_pool&) = delete;
+
+        [[nodiscard]] unsigned int get_num_threads() const {
+            return (unsigned int)workers.size();
+        }
+
+        /**
+         * Submit a Callable for the pool to execute and return a std::future.
+         */
+        template <typename F, typename... A,
+            typename R = std::invoke_result_t<std::decay_t<F>, std::decay_t<A>...>>
+        [[nodiscard]] std::future<R> submit(F&& func, A&&... args) {
+            auto ptask = std::make_shared<std::packaged_task<R()>>(std::bind(std::forward<F>(func), std::forward<A>(args)...));
+            submit_detach([ptask] { (*ptask)(); });
+            return ptask->get_future();
+        }
+
+        /**
+         * Submit a zero-argument Callable for the pool to execute.
+         */
+        template <typename F>
+        void submit_detach(F&& func) {
+            auto* task = new task_type(std::forward<F>(func));
+
+            if (current_pool == this) {
+                // Submitted by one of our own tasks. Keep it local, where it is also open for stealing.
+                workers[current_worker]->deque.push(task);
+            } else {
+                worker& w = *workers[next_inbox.fetch_add(1, std::memory_order_relaxed) % workers.size()];
+                std::lock_guard<std::mutex> lock(w.inbox_mutex);
+                w.inbox.push_back(task);
+            }
+
+            pending.fetch_add(1, std::memory_order_seq_cst);
+            if (sleeping.load(std::memory_order_seq_cst) > 0) {
+                std::lock_guard<std::mutex> lock(sleep_mutex);
+                sleep_cv.notify_one();
+            }
+        }
+
+    protected:
+        using task_type = std::function<void()>;
+
+        struct worker {
+            work_stealing_deque<task_type*> deque;
+
+            std::mutex inbox_mutex;
+            std::vector<task_type*> inbox;
+
+            // Reused to move the inbox into the deque.
+            std::vector<task_type*> drained;
+        };
+
+        /**
+         * Find a task to run. Never blocks.
+         */
+        task_type* find_task(unsigned int self) {
+            worker& w = *workers[self];
+
+            if (task_type* task = w.deque.pop()) {
+                return task;
+            }
+
+            // Own deque is empty. Move the inbox into it, oldest at the bottom so it is popped first.
+            {
+                std::lock_guard<std::mutex> lock(w.inbox_mutex);
+                std::swap(w.inbox, w.drained);
+            }
+            for (auto it = w.drained.rbegin(); it != w.drained.rend(); ++it) {
+                w.deque.push(*it);
+            }
+            w.drained.clear();
+            if (task_type* task = w.deque.pop()) {
+                return task;
+            }
+
+            // Steal from the other workers, starting with the next one over.
+            const auto n = (unsigned int)workers.size();
+            for (unsigned int i = 1; i < n; ++i) {
+                if (task_type* task = workers[(self + i) % n]->deque.steal()) {
+                    return task;
+                }
+            }
+
+            // Take from inboxes of workers that are busy with a long task.
+            for (unsigned int i = 1; i < n; ++i) {
+                worker& victim = *workers[(self + i) % n];
+                std::unique_lock<std::mutex> lock(victim.inbox_mutex, std::try_to_lock);
+                if (lock.owns_lock() && !victim.inbox.empty()) {
+                    task_type* task = victim.inbox.front();
+                    victim.inbox.erase(victim.inbox.begin());
+                    return task;
+                }
+            }
+
+            return nullptr;
+        }
+
+        void worker_main(unsigned int self) {
+            current_pool = this;
+            current_worker = self;
+
+            while (true) {
+                if (task_type* task = find_task(self)) {
+                    pending.fetch_sub(1, std::memory_order_relaxed);
+                    (*task)();
+                    delete task;
+                    continue;
+                }
+
+                std::unique_lock<std::mutex> lock(sleep_mutex);
+                sleeping.fetch_add(1, std::memory_order_seq_cst);
+                sleep_cv.wait(lock, [&] { return pending.load(std::memory_order_seq_cst) > 0 || stopping; });
+                sleeping.fetch_sub(1, std::memory_order_seq_cst);
+                if (stopping && pending.load(std::memory_order_seq_cst) == 0) {
+                    return;
+                }
+            }
+        }
+
+        std::vector<std::unique_ptr<worker>> workers;
+        std::vector<std::thread> threads;
+
+        std::atomic<std::size_t> next_inbox{0};
+
+        /**
+         * Number of submitted tasks that have not been picked up by a worker.
+         */
+        std::atomic<int64_t> pending{0};
+
+        std::mutex sleep_mutex;
+        std::condition_variable sleep_cv;
+        std::atomic<int> sleeping{0};
+        bool stopping = false;
+
+        static inline thread_local work_stealing_thread_pool* current_pool = nullptr;
+        static inline thread_local unsigned int current_worker = 0;
+    };
+}
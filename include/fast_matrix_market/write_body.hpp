@@ -49,11 +49,19 @@ namespace fast_matrix_market {
     template <typename FORMATTER>
     void write_body_sequential(std::ostream& os,
                                FORMATTER& formatter, const write_options& options = {}) {
+        // Reuse one chunk buffer.
+        auto buffers = options.buffer_pool ? options.buffer_pool : std::make_shared<chunk_buffer_pool>(1);
+        scoped_chunk_buffer_pool scope(buffers.get());
+        progress_reporter progress(options);
 
         while (formatter.has_next()) {
             std::string chunk = formatter.next_chunk(options)();
 
             os.write(chunk.c_str(), (std::streamsize)chunk.size());
+            if (progress.is_enabled()) {
+                progress.add_chunk((int64_t)chunk.size(), count_chunk_elements(chunk));
+            }
+            buffers->release(std::move(chunk));
         }
     }
 
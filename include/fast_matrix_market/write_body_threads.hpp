@@ -4,12 +4,115 @@
 
 #pragma once
 
+#include <algorithm>
 #include <queue>
 
 #include "fast_matrix_market.hpp"
-#include "thirdparty/task_thread_pool.hpp"
+#include "buffer_pool.hpp"
+#include "compress.hpp"
+#include "instrumentation.hpp"
+#include "pwrite_file.hpp"
+#include "thread_pool.hpp"
 
 namespace fast_matrix_market {
+    /**
+     * Number of elements in a formatted chunk. Every element is one line.
+     */
+    inline int64_t count_chunk_elements(std::string_view chunk) {
+        return (int64_t)std::count(chunk.begin(), chunk.end(), '\n');
+    }
+
+#ifdef FMM_HAVE_PWRITE
+    /**
+     * Write Matrix Market body in parallel with pwrite().
+     *
+     * Each chunk task formats its chunk, then waits for the end offset of the previous chunk. That chain is an
+     * ordered prefix sum of chunk sizes. Once a task knows its offset it publishes its own end offset, so the next
+     * task can proceed, and writes its chunk directly into the file. Writes happen concurrently and no thread
+     * serializes the output.
+     *
+     * Tasks only ever wait on tasks submitted before them, and the pool runs tasks in submission order, so
+     * this cannot deadlock.
+     */
+    template <typename FORMATTER>
+    void write_body_pwrite(pwrite_streambuf& out,
+                           FORMATTER& formatter, const write_options& options = {}) {
+        // Declared before the pool so that it outlives the tasks that record into it.
+        pipeline_recorder recorder(options);
+        pipeline_recorder* rec = recorder.get();
+
+        scoped_thread_pool pool(options);
+        recorder.set_num_threads(pool.get_num_threads());
+        progress_reporter progress(options, &pool);
+        const bool count_elements = progress.is_enabled();
+
+        // Each task returns the size of its chunk and, if progress is reported, its number of elements.
+        // Declared after the pool: a future holds its task, and so the task's end offset promise. If the write is
+        // cancelled, dropping the futures first breaks those promises so that running tasks stop waiting on them.
+        std::queue<std::pair<std::future<std::pair<int64_t, int64_t>>, int64_t>> futures;
+
+        // Bounds the number of formatted chunks held in memory.
+        const int inflight_count = 2 * (int)pool.get_num_threads();
+        inflight_budget budget(options, 0);
+
+        // Chunks are formatted into buffers from this pool, and returned to it once written.
+        auto buffers = options.buffer_pool ? options.buffer_pool : std::make_shared<chunk_buffer_pool>();
+
+        std::promise<int64_t> body_start;
+        body_start.set_value(out.tell());
+        std::shared_future<int64_t> prev_end = body_start.get_future().share();
+
+        while (formatter.has_next() || !futures.empty()) {
+            if ((int)futures.size() >= inflight_count || !formatter.has_next() || !budget.has_room()) {
+                // Rethrows any formatting or write error.
+                auto& [future, charge] = futures.front();
+                auto [chunk_size, chunk_elements] = recorder.get(future);
+                recorder.add_chunk(chunk_size);
+                budget.update(charge, chunk_size);
+                budget.remove(charge);
+                futures.pop();
+                progress.add_chunk(chunk_size, chunk_elements);
+                continue;
+            }
+
+            auto end_promise = std::make_shared<std::promise<int64_t>>();
+            std::shared_future<int64_t> end = end_promise->get_future().share();
+
+            auto future = pool.submit([&out, prev_end, end_promise, buffers, rec, count_elements](auto chunk) {
+                std::string chunk_str;
+                int64_t offset;
+                try {
+                    {
+                        stage_timer timer(rec, stage_format);
+                        scoped_chunk_buffer_pool scope(buffers.get());
+                        chunk_str = chunk();
+                    }
+                    offset = prev_end.get();
+                    end_promise->set_value(offset + (int64_t)chunk_str.size());
+                } catch (...) {
+                    // Make sure later chunks do not wait forever.
+                    end_promise->set_exception(std::current_exception());
+                    throw;
+                }
+                {
+                    stage_timer timer(rec, stage_write);
+                    out.write_at(chunk_str.data(), chunk_str.size(), offset);
+                }
+                auto size = (int64_t)chunk_str.size();
+                int64_t elements = count_elements ? count_chunk_elements(chunk_str) : 0;
+                buffers->release(std::move(chunk_str));
+                return std::make_pair(size, elements);
+            }, formatter.next_chunk(options));
+            futures.emplace(std::move(future), budget.add());
+
+            prev_end = end;
+        }
+
+        // Anything written after the body goes after the last chunk.
+        out.seek(prev_end.get());
+    }
+#endif
+
     /**
      * Write Matrix Market body.
      *
@@ -19,6 +122,12 @@ namespace fast_matrix_market {
     template <typename FORMATTER>
     void write_body_threads(std::ostream& os,
                             FORMATTER& formatter, const write_options& options = {}) {
+#ifdef FMM_HAVE_PWRITE
+        if (auto* pbuf = dynamic_cast<pwrite_streambuf*>(os.rdbuf())) {
+            write_body_pwrite(*pbuf, formatter, options);
+            return;
+        }
+#endif
         /*
          * Requirements:
          * Chunks must be created sequentially by the formatter.
@@ -32,34 +141,81 @@ namespace fast_matrix_market {
          *
          * We take a simple approach. The main thread handles the serial chunk generation and I/O,
          * and a thread pool performs the parallel work.
+         *
+         * A compress_ostream has each worker also compress its chunk into an independent block.
+         *
+         * Chunks are formatted into buffers from a chunk_buffer_pool, and returned to it once written.
          */
-        std::queue<std::future<std::string>> futures;
-        task_thread_pool::task_thread_pool pool(options.num_threads);
+        // Declared before the pool so that it outlives the tasks that record into it.
+        pipeline_recorder recorder(options);
+        pipeline_recorder* rec = recorder.get();
+
+        auto* cbuf = dynamic_cast<compress_streambuf*>(os.rdbuf());
+        auto buffers = options.buffer_pool ? options.buffer_pool : std::make_shared<chunk_buffer_pool>();
+        // Each task returns its chunk and, if progress is reported, the chunk's number of elements.
+        const bool count_elements = (bool)options.progress_callback;
+        auto task = [cbuf, buffers, rec, count_elements](auto chunk) {
+            stage_timer timer(rec, stage_format);
+            scoped_chunk_buffer_pool scope(buffers.get());
+            std::string chunk_str = chunk();
+            int64_t elements = count_elements ? count_chunk_elements(chunk_str) : 0;
+            if (cbuf == nullptr) {
+                return std::make_pair(std::move(chunk_str), elements);
+            }
+            std::string block = cbuf->compress(chunk_str);
+            buffers->release(std::move(chunk_str));
+            return std::make_pair(std::move(block), elements);
+        };
+
+        // Each chunk's future and its inflight_budget charge.
+        std::queue<std::pair<std::future<std::pair<std::string, int64_t>>, int64_t>> futures;
+        scoped_thread_pool pool(options);
+        recorder.set_num_threads(pool.get_num_threads());
+        progress_reporter progress(options, &pool);
 
         // Number of concurrent chunks available to work on.
         // Too few may starve workers (such as due to uneven chunk splits)
         // Too many increases costs, such as storing chunk results in memory before they're written.
         const int inflight_count = 2 * (int)pool.get_num_threads();
+        inflight_budget budget(options, 0);
 
         // Start computing tasks.
-        for (int batch_i = 0; batch_i < inflight_count && formatter.has_next(); ++batch_i) {
-            // Could push the chunk directly, but MSVC.
-            futures.push(pool.submit([](auto chunk){ return chunk(); }, formatter.next_chunk(options)));
-//            futures.push(pool.submit(formatter.next_chunk(options)));
-        }
+        auto submit_chunks = [&]() {
+            while ((int)futures.size() < inflight_count && formatter.has_next() && budget.has_room()) {
+                // Could push the chunk directly, but MSVC.
+                auto future = pool.submit(task, formatter.next_chunk(options));
+                futures.emplace(std::move(future), budget.add());
+            }
+        };
+        submit_chunks();
 
         // Write chunks in order as they become available.
         while (!futures.empty()) {
-            std::string chunk = futures.front().get();
+            auto [future, charge] = std::move(futures.front());
             futures.pop();
+            auto [chunk, chunk_elements] = recorder.get(future);
+            recorder.add_chunk((int64_t)chunk.size());
+            budget.update(charge, (int64_t)chunk.size());
 
             // Next chunk is ready. Start another to replace it.
-            if (formatter.has_next()) {
-                futures.push(pool.submit([](auto chunk){ return chunk(); }, formatter.next_chunk(options)));
-            }
+            submit_chunks();
 
             // Write this one out.
-            os.write(chunk.c_str(), (std::streamsize) chunk.size());
+            {
+                stage_timer timer(rec, stage_write, false);
+                if (cbuf != nullptr) {
+                    cbuf->write_block(chunk);
+                } else {
+                    os.write(chunk.c_str(), (std::streamsize) chunk.size());
+                }
+            }
+            auto chunk_size = (int64_t)chunk.size();
+            buffers->release(std::move(chunk));
+            budget.remove(charge);
+            progress.add_chunk(chunk_size, chunk_elements);
+
+            // An over-budget pipeline may only continue once this chunk is written.
+            submit_chunks();
         }
     }
 }
@@ -177,11 +177,13 @@ def _get_read_cursor(source, parallelism=None):
 
     if is_path:
         path = str(source)
-        if path.endswith('.gz'):
+        # Compressed files are opened by the C++ core if it was built with support for the format.
+        # Otherwise fall back to Python's decompressors.
+        if path.endswith('.gz') and "gzip" not in _fmm_core.native_decompression:
             import gzip
             source = gzip.GzipFile(path, 'r')
             ret_stream_to_close = source
-        elif path.endswith('.bz2'):
+        elif path.endswith('.bz2') and "bzip2" not in _fmm_core.native_decompression:
             import bz2
             source = bz2.BZ2File(path, 'rb')
             ret_stream_to_close = source
@@ -408,7 +410,15 @@ def read_array_or_coo(source, parallelism=None, long_type=False, generalize_symm
         return (data, (rows, cols)), shape
 
 
-def mmread(source, parallelism=None, long_type=False):
+def _collect_stats(cursor, stats):
+    """
+    Copy a cursor's measurements into a user's dict. See the `stats` argument of mmread() and mmwrite().
+    """
+    if stats is not None:
+        stats.update(cursor.stats())
+
+
+def mmread(source, parallelism=None, long_type=False, stats=None):
     """
     Read MatrixMarket file. If the file is dense, return a 2D numpy array. Else return a SciPy sparse matrix.
 
@@ -417,25 +427,31 @@ def mmread(source, parallelism=None, long_type=False):
     :param source: path to MatrixMarket file or open file-like object
     :param parallelism: number of threads to use. 0 means auto.
     :param long_type: Whether to use 'longdouble' and 'longcomplex' extended-precision floating-point number types.
+    :param stats: if a dict, it is filled with measurements of the read: bytes, chunks, per-stage wall and CPU time
+    in nanoseconds, worker idle time, backpressure stalls and peak buffered bytes.
     :return: an ndarray if the MatrixMarket file is dense, a scipy.sparse.coo_matrix if the MatrixMarket file is sparse.
     """
     cursor, stream_to_close = _get_read_cursor(source, parallelism)
+    if stats is not None:
+        cursor.enable_stats()
 
     if cursor.header.format == "array":
         mat = _read_body_array(cursor, long_type=long_type)
+        _collect_stats(cursor, stats)
         if stream_to_close:
             stream_to_close.close()
         return mat
     else:
         from scipy.sparse import coo_matrix
         triplet, shape = _read_body_coo(cursor, long_type=long_type, generalize_symmetry=True)
+        _collect_stats(cursor, stats)
         if stream_to_close:
             stream_to_close.close()
         return coo_matrix(triplet, shape=shape)
 
 
 def mmwrite(target, a, comment=None, field=None, precision=None, symmetry="AUTO",
-            parallelism=None, find_symmetry=False):
+            parallelism=None, find_symmetry=False, stats=None):
     """
     Write a matrix to a MatrixMarket file or file-like object.
 
@@ -451,6 +467,7 @@ def mmwrite(target, a, comment=None, field=None, precision=None, symmetry="AUTO"
     :param parallelism: number of threads to use. 0 means auto.
     :param find_symmetry: autodetect what symmetry the matrix contains and set the `symmetry` field accordingly. This
     can be slow. scipy.io.mmwrite always does this if symmetry is not set, but it is very slow on large matrices.
+    :param stats: if a dict, it is filled with measurements of the write. See mmread().
     """
     import numpy as np
     import scipy.sparse
@@ -475,11 +492,14 @@ def mmwrite(target, a, comment=None, field=None, precision=None, symmetry="AUTO"
 
     symmetry = _validate_symmetry(symmetry)
     cursor = _get_write_cursor(target, comment=comment, parallelism=parallelism, precision=precision, symmetry=symmetry)
+    if stats is not None:
+        cursor.enable_stats()
 
     if isinstance(a, np.ndarray):
         # Write dense numpy arrays
         a = _apply_field(a, field, no_pattern=True)
         _fmm_core.write_body_array(cursor, a)
+        _collect_stats(cursor, stats)
         return
 
     # handle both scipy.sparse.*_matrix and scipy.sparse.*_array
@@ -540,6 +560,7 @@ def mmwrite(target, a, comment=None, field=None, precision=None, symmetry="AUTO"
             _fmm_core.write_body_csc(cursor, a.shape, a.indptr, a.indices, data, is_csr)
         else:
             _fmm_core.write_body_coo(cursor, a.shape, a.row, a.col, data)
+        _collect_stats(cursor, stats)
         return
 
     raise ValueError("unknown matrix type: %s" % type(a))
@@ -162,6 +162,35 @@ write_cursor open_write_stream(std::shared_ptr<pystream::ostream>& stream, fmm::
 }
 
 #ifndef FMM_SCIPY_PRUNE
+/**
+ * Measurements of a read or write. See fmm::pipeline_stats.
+ */
+py::dict stats_to_dict(const std::shared_ptr<fmm::pipeline_stats>& stats) {
+    py::dict dict;
+    if (!stats) {
+        return dict;
+    }
+
+    py::dict stages;
+    for (const auto& [stage, name] : fmm::pipeline_stage_map) {
+        const auto& s = stats->stages[stage];
+        py::dict stage_dict;
+        stage_dict["count"] = s.count;
+        stage_dict["wall_ns"] = s.wall_ns;
+        stage_dict["cpu_ns"] = s.cpu_ns;
+        stages[py::str(name)] = stage_dict;
+    }
+    dict["stages"] = stages;
+    dict["wall_ns"] = stats->wall_ns;
+    dict["bytes"] = stats->bytes;
+    dict["chunks"] = stats->chunks;
+    dict["stalls"] = stats->stalls;
+    dict["stall_ns"] = stats->stall_ns;
+    dict["worker_idle_ns"] = stats->worker_idle_ns;
+    dict["peak_inflight_bytes"] = stats->peak_inflight_bytes;
+    return dict;
+}
+
 void write_header_only(write_cursor& cursor) {
     fmm::write_header(cursor.stream(), cursor.header, cursor.options);
     cursor.close();
@@ -226,11 +255,22 @@ PYBIND11_MODULE(_fmm_core, m) {
     // Read methods
     py::class_<read_cursor>(m, "_read_cursor", py::module_local())
     .def_readonly("header", &read_cursor::header)
+    .def("enable_stats", [](read_cursor& cursor) { cursor.options.stats = std::make_shared<fmm::pipeline_stats>(); })
+    .def("stats", [](const read_cursor& cursor) { return stats_to_dict(cursor.options.stats); })
     .def("close", &read_cursor::close);
 
     m.def("open_read_file", &open_read_file);
     m.def("open_read_stream", &open_read_stream);
 
+    // Compressed formats that open_read_file() decompresses natively.
+    py::list native_decompression;
+    for (auto compression : {fmm::GzipCompression, fmm::Bzip2Compression, fmm::ZstdCompression}) {
+        if (fmm::is_decompression_supported(compression)) {
+            native_decompression.append(fmm::compression_name(compression));
+        }
+    }
+    m.attr("native_decompression") = native_decompression;
+
     init_read_array(m);
     init_read_coo(m);
 
@@ -240,6 +280,8 @@ PYBIND11_MODULE(_fmm_core, m) {
 #ifndef FMM_SCIPY_PRUNE
     .def_readwrite("header", &write_cursor::header)
 #endif
+    .def("enable_stats", [](write_cursor& cursor) { cursor.options.stats = std::make_shared<fmm::pipeline_stats>(); })
+    .def("stats", [](const write_cursor& cursor) { return stats_to_dict(cursor.options.stats); })
     ;
 
     m.def("open_write_file", &open_write_file);
@@ -33,9 +33,9 @@ namespace fmm = fast_matrix_market;
  */
 struct read_cursor {
     /**
-     * Open a file.
+     * Open a file. Compressed files are decompressed natively if this build supports the format.
      */
-    read_cursor(const std::string& filename): stream_ptr(std::make_shared<std::ifstream>(filename)) {}
+    read_cursor(const std::string& filename): stream_ptr(std::make_shared<fmm::mapped_istream>(filename)) {}
 
     /**
      * Use a Python stream. Needs to be a shared_ptr because this stream object needs to stay alive for the lifetime
@@ -56,13 +56,7 @@ struct read_cursor {
      * Finish using the cursor. If a file has been opened it will be closed.
      */
     void close() {
-        // If stream is a std::ifstream() then close the file.
-        std::ifstream* f = dynamic_cast<std::ifstream*>(stream_ptr.get());
-        if (f != nullptr) {
-            f->close();
-        }
-
-        // Remove this reference to the stream.
+        // Remove this reference to the stream. A file is closed and unmapped once the last reference is gone.
         stream_ptr.reset();
     }
 };
@@ -155,6 +155,22 @@ class TestSciPy(unittest.TestCase):
         fmm.mmread(path)
         # scipy.io._mmio.mmread() cannot read CRLF files on Unix
 
+    def test_stats(self):
+        m = scipy.sparse.random(100, 100, density=0.1, format="coo", random_state=0)
+
+        write_stats = {}
+        bio = BytesIO()
+        fmm.mmwrite(bio, m, stats=write_stats)
+        self.assertGreater(write_stats["chunks"], 0)
+        self.assertEqual(write_stats["stages"]["format"]["count"], write_stats["chunks"])
+
+        read_stats = {}
+        m_fmm = fmm.mmread(BytesIO(bio.getvalue()), stats=read_stats)
+        self.assertMatrixEqual(m, m_fmm)
+        self.assertEqual(read_stats["bytes"], write_stats["bytes"])
+        self.assertGreater(read_stats["stages"]["parse"]["count"], 0)
+        self.assertIn("peak_inflight_bytes", read_stats)
+
     def test_write(self):
         for mtx in sorted(list(matrices.glob("*.mtx"))):
             mtx_header = fmm.read_header(mtx)
@@ -12,6 +12,7 @@
 #endif
 
 #include "fmm_tests.hpp"
+#include <fast_matrix_market/app/batch.hpp>
 #include <fast_matrix_market/app/generator.hpp>
 
 #if defined(__clang__)
@@ -36,6 +37,11 @@ void read_triplet_file(const std::string& matrix_filename, TRIPLET& triplet, fas
     fast_matrix_market::read_matrix_market_triplet(f, triplet.nrows, triplet.ncols, triplet.rows, triplet.cols, triplet.vals, options);
 }
 
+template <typename TRIPLET>
+void read_triplet_mapped_file(const std::string& matrix_filename, TRIPLET& triplet, fast_matrix_market::read_options options = {}) {
+    fast_matrix_market::read_matrix_market_triplet(kTestMatrixDir + "/" + matrix_filename, triplet.nrows, triplet.ncols, triplet.rows, triplet.cols, triplet.vals, options);
+}
+
 template <typename TRIPLET>
 void read_triplet_string(const std::string& s, TRIPLET& triplet, fast_matrix_market::read_options options = {}) {
     std::istringstream f(s);
@@ -216,6 +222,31 @@ TEST_P(InvalidSuite, Small) {
     options.parallel_ok = false;
     EXPECT_THROW(read_triplet_file(GetParam(), triplet_lc, options), fast_matrix_market::invalid_mm);
     EXPECT_THROW(read_triplet_file(GetParam(), triplet_lld, options), fast_matrix_market::invalid_mm);
+
+    // Also verify memory-mapped
+    options.chunk_size_bytes = 1;
+    EXPECT_THROW(read_triplet_mapped_file(GetParam(), triplet_ld, options), fast_matrix_market::invalid_mm);
+    options.parallel_ok = true;
+    EXPECT_THROW(read_triplet_mapped_file(GetParam(), triplet_ld, options), fast_matrix_market::invalid_mm);
+
+    // Also verify fused count and parse reports the same error as the sequential reader
+    std::string sequential_error, fused_error;
+    options.parallel_ok = false;
+    try {
+        read_triplet_file(GetParam(), triplet_ld, options);
+    } catch (fast_matrix_market::invalid_mm& e) {
+        sequential_error = e.what();
+    }
+    options.parallel_ok = true;
+    options.fused_count_parse = true;
+    options.num_threads = 4;
+    try {
+        read_triplet_file(GetParam(), triplet_ld, options);
+    } catch (fast_matrix_market::invalid_mm& e) {
+        fused_error = e.what();
+    }
+    EXPECT_FALSE(fused_error.empty());
+    EXPECT_EQ(sequential_error, fused_error);
 }
 
 INSTANTIATE_TEST_SUITE_P(Invalid, InvalidSuite, testing::ValuesIn(InvalidSuite::get_invalid_matrix_files()));
@@ -615,6 +646,17 @@ TEST_P(SymmetrySuite, SmallTripletCoordinate) {
     EXPECT_EQ(sym_zero, general_zero);
     EXPECT_EQ(sym_dup, general_dup);
     EXPECT_EQ(sym_app, general_app);
+
+    // Fused count and parse
+    SymMat sym_zero_fused, sym_dup_fused;
+    ro_gen_zero.fused_count_parse = true;
+    ro_gen_zero.num_threads = 4;
+    ro_gen_dup.fused_count_parse = true;
+    ro_gen_dup.num_threads = 4;
+    read_triplet_file(p.symmetric, sym_zero_fused, ro_gen_zero);
+    read_triplet_file(p.symmetric, sym_dup_fused, ro_gen_dup);
+    EXPECT_EQ(sym_zero_fused, general_zero);
+    EXPECT_EQ(sym_dup_fused, general_dup);
 }
 
 class SymmetryTripletArraySuite : public SymmetrySuite {};
@@ -712,6 +754,937 @@ TEST(Whitespace, Whitespace) {
     }
 }
 
+TEST(MappedFile, MatchesStream) {
+    for (const char* name : {"eye3.mtx", "eye3_pattern.mtx", "nist_ex1.mtx", "nist_ex1_more_freeformat.mtx",
+                                    "kepner_gilbert_graph.mtx", "vector_coordinate.mtx",
+                                    "permissive/windows_lineendings_nist_ex1_more_freeformat.mtx"}) {
+        triplet_matrix<int64_t, double> expected;
+        read_triplet_file(name, expected);
+
+        for (int chunk_size : {1, 10, 15, 1000}) {
+            for (int p : {1, 4}) {
+                fast_matrix_market::read_options options;
+                options.chunk_size_bytes = chunk_size;
+                options.num_threads = p;
+
+                triplet_matrix<int64_t, double> mat;
+                read_triplet_mapped_file(name, mat, options);
+                EXPECT_EQ(mat, expected) << name << " chunk_size=" << chunk_size << " p=" << p;
+            }
+        }
+    }
+
+    for (const char* name : {"nist_ex1_more_freeformat.mtx", "kepner_gilbert_graph.mtx", "vector_coordinate.mtx"}) {
+        triplet_matrix<int64_t, double> expected;
+        read_triplet_file(name, expected);
+
+        for (int chunk_size : {1, 15, 1000}) {
+            fast_matrix_market::read_options options;
+            options.chunk_size_bytes = chunk_size;
+            options.num_threads = 4;
+            options.fused_count_parse = true;
+
+            triplet_matrix<int64_t, double> mat, mat_mapped;
+            read_triplet_file(name, mat, options);
+            EXPECT_EQ(mat, expected) << name << " fused chunk_size=" << chunk_size;
+            read_triplet_mapped_file(name, mat_mapped, options);
+            EXPECT_EQ(mat_mapped, expected) << name << " fused mapped chunk_size=" << chunk_size;
+        }
+    }
+
+    {
+        array_matrix<double> expected, mat;
+        read_array_file("eye3_array.mtx", expected);
+        fast_matrix_market::read_matrix_market_array(kTestMatrixDir + "/eye3_array.mtx", mat.nrows, mat.ncols, mat.vals, mat.order);
+        EXPECT_EQ(mat, expected);
+    }
+
+    {
+        fast_matrix_market::mapped_istream f(kTestMatrixDir + "/eye3.mtx");
+        EXPECT_TRUE(f.is_open());
+#ifdef FMM_HAVE_MMAP
+        EXPECT_TRUE(f.is_mapped());
+#endif
+    }
+
+    triplet_matrix<int64_t, double> mat;
+    EXPECT_THROW(read_triplet_mapped_file("does_not_exist.mtx", mat), fast_matrix_market::invalid_argument);
+}
+
+std::string read_file_bytes(const std::string& path) {
+    std::ifstream f(path, std::ios_base::binary);
+    std::ostringstream oss;
+    oss << f.rdbuf();
+    return oss.str();
+}
+
+TEST(PwriteFile, MatchesStream) {
+    const std::string path = (std::filesystem::temp_directory_path() / "fmm_pwrite_test.mtx").string();
+
+    for (const char* name : {"eye3.mtx", "nist_ex1.mtx", "kepner_gilbert_graph.mtx"}) {
+        triplet_matrix<int64_t, double> mat;
+        read_triplet_file(name, mat);
+
+        for (int num_threads : {1, 4}) {
+            fast_matrix_market::write_options options;
+            options.chunk_size_values = 1;
+            options.num_threads = num_threads;
+
+            std::ostringstream oss;
+            fast_matrix_market::write_matrix_market_triplet(oss, {mat.nrows, mat.ncols}, mat.rows, mat.cols, mat.vals, options);
+
+            fast_matrix_market::write_matrix_market_triplet(path, {mat.nrows, mat.ncols}, mat.rows, mat.cols, mat.vals, options);
+            EXPECT_EQ(read_file_bytes(path), oss.str()) << name << " num_threads=" << num_threads;
+        }
+    }
+
+    {
+        array_matrix<double> mat;
+        read_array_file("eye3_array.mtx", mat);
+
+        fast_matrix_market::write_options options;
+        options.num_threads = 4;
+        std::string expected = write_array_string(mat, options);
+
+        options.chunk_size_values = 1;
+        fast_matrix_market::write_matrix_market_array(path, {mat.nrows, mat.ncols}, mat.vals, mat.order, options);
+        EXPECT_EQ(read_file_bytes(path), expected);
+    }
+
+    std::filesystem::remove(path);
+
+    triplet_matrix<int64_t, double> mat;
+    EXPECT_THROW(fast_matrix_market::write_matrix_market_triplet(kTestMatrixDir + "/does_not_exist/out.mtx", {3, 3}, mat.rows, mat.cols, mat.vals),
+                 fast_matrix_market::invalid_argument);
+}
+
+#ifdef FMM_USE_ZLIB
+std::string gzip_compress(const std::string& data) {
+    z_stream zs{};
+    // 15 + 16: gzip wrapper
+    deflateInit2(&zs, Z_DEFAULT_COMPRESSION, Z_DEFLATED, 15 + 16, 8, Z_DEFAULT_STRATEGY);
+    std::string out(deflateBound(&zs, (uLong)data.size()), '\0');
+    zs.next_in = reinterpret_cast<Bytef*>(const_cast<char*>(data.data()));
+    zs.avail_in = (uInt)data.size();
+    zs.next_out = reinterpret_cast<Bytef*>(out.data());
+    zs.avail_out = (uInt)out.size();
+    deflate(&zs, Z_FINISH);
+    out.resize(zs.total_out);
+    deflateEnd(&zs);
+    return out;
+}
+#endif
+
+#ifdef FMM_USE_BZIP2
+std::string bzip2_compress(const std::string& data) {
+    std::string out(data.size() + data.size() / 100 + 600, '\0');
+    auto out_size = (unsigned int)out.size();
+    BZ2_bzBuffToBuffCompress(out.data(), &out_size, const_cast<char*>(data.data()), (unsigned int)data.size(), 9, 0, 0);
+    out.resize(out_size);
+    return out;
+}
+#endif
+
+#ifdef FMM_USE_ZSTD
+std::string zstd_compress(const std::string& data) {
+    std::string out(ZSTD_compressBound(data.size()), '\0');
+    out.resize(ZSTD_compress(out.data(), out.size(), data.data(), data.size(), 1));
+    return out;
+}
+#endif
+
+TEST(Decompress, Formats) {
+    const std::string path = (std::filesystem::temp_directory_path() / "fmm_decompress_test.mtx").string();
+
+    std::string mtx = read_file_bytes(kTestMatrixDir + "/kepner_gilbert_graph.mtx");
+    triplet_matrix<int64_t, double> expected;
+    read_triplet_file("kepner_gilbert_graph.mtx", expected);
+
+    // Split in two to test concatenated streams, as written by parallel compressors.
+    std::string first = mtx.substr(0, mtx.size() / 2), second = mtx.substr(mtx.size() / 2);
+    std::vector<std::pair<std::string, std::string>> inputs = {{"uncompressed", mtx}};
+#ifdef FMM_USE_ZLIB
+    inputs.emplace_back("gzip", gzip_compress(mtx));
+    inputs.emplace_back("gzip concatenated", gzip_compress(first) + gzip_compress(second));
+#endif
+#ifdef FMM_USE_BZIP2
+    inputs.emplace_back("bzip2", bzip2_compress(mtx));
+    inputs.emplace_back("bzip2 concatenated", bzip2_compress(first) + bzip2_compress(second));
+#endif
+#ifdef FMM_USE_ZSTD
+    inputs.emplace_back("zstd", zstd_compress(mtx));
+    inputs.emplace_back("zstd frames", zstd_compress(first) + zstd_compress(second));
+#endif
+
+    for (const auto& [name, bytes] : inputs) {
+        for (int p : {1, 4}) {
+            fast_matrix_market::read_options options;
+            options.chunk_size_bytes = 15;
+            options.num_threads = p;
+
+            {
+                std::istringstream iss(bytes);
+                fast_matrix_market::decompress_istream decompressed(iss, options);
+                triplet_matrix<int64_t, double> mat;
+                fast_matrix_market::read_matrix_market_triplet(decompressed, mat.nrows, mat.ncols, mat.rows, mat.cols, mat.vals, options);
+                EXPECT_EQ(mat, expected) << name << " stream p=" << p;
+            }
+
+            {
+                std::ofstream f(path, std::ios_base::binary);
+                f << bytes;
+            }
+            triplet_matrix<int64_t, double> mat;
+            fast_matrix_market::read_matrix_market_triplet(path, mat.nrows, mat.ncols, mat.rows, mat.cols, mat.vals, options);
+            EXPECT_EQ(mat, expected) << name << " path p=" << p;
+        }
+
+        if (name != "uncompressed") {
+            // Truncated input must not be mistaken for a shorter file.
+            std::istringstream iss(bytes.substr(0, bytes.size() / 2));
+            fast_matrix_market::decompress_istream decompressed(iss);
+            triplet_matrix<int64_t, double> mat;
+            EXPECT_THROW(fast_matrix_market::read_matrix_market_triplet(decompressed, mat.nrows, mat.ncols, mat.rows, mat.cols, mat.vals),
+                         fast_matrix_market::fmm_error) << name;
+        }
+    }
+
+    std::filesystem::remove(path);
+
+    EXPECT_EQ(fast_matrix_market::detect_compression(mtx.data(), mtx.size()), fast_matrix_market::NoCompression);
+#ifndef FMM_USE_ZSTD
+    std::istringstream iss(std::string("\x28\xb5\x2f\xfd", 4));
+    EXPECT_THROW(fast_matrix_market::decompress_istream decompressed(iss), fast_matrix_market::fmm_error);
+#endif
+}
+
+#ifdef FMM_USE_ZLIB
+TEST(Compress, RoundTrip) {
+    const std::string path = (std::filesystem::temp_directory_path() / "fmm_compress_test.mtx").string();
+
+    triplet_matrix<int64_t, double> expected;
+    read_triplet_file("kepner_gilbert_graph.mtx", expected);
+
+    std::vector<fast_matrix_market::compression_type> compressions = {fast_matrix_market::GzipCompression};
+#ifdef FMM_USE_ZSTD
+    compressions.push_back(fast_matrix_market::ZstdCompression);
+#endif
+
+    for (auto compression : compressions) {
+        for (int p : {1, 4}) {
+            fast_matrix_market::write_options write_options;
+            write_options.chunk_size_values = 3;
+            write_options.num_threads = p;
+
+            std::ostringstream oss;
+            {
+                fast_matrix_market::compress_ostream compressed(oss, compression);
+                fast_matrix_market::write_matrix_market_triplet(compressed, {expected.nrows, expected.ncols},
+                                                                expected.rows, expected.cols, expected.vals, write_options);
+            }
+            std::string bytes = oss.str();
+            EXPECT_EQ(fast_matrix_market::detect_compression(bytes.data(), bytes.size()), compression);
+            if (p > 1) {
+                // One block per chunk, plus the header.
+                auto blocks = fast_matrix_market::find_compressed_blocks(compression, bytes.data(), bytes.data() + bytes.size());
+                EXPECT_GT(blocks.size(), 2);
+            }
+
+            fast_matrix_market::read_options options;
+            options.chunk_size_bytes = 15;
+            options.num_threads = 4;
+
+            {
+                std::istringstream iss(bytes);
+                fast_matrix_market::decompress_istream decompressed(iss, options);
+                triplet_matrix<int64_t, double> mat;
+                fast_matrix_market::read_matrix_market_triplet(decompressed, mat.nrows, mat.ncols, mat.rows, mat.cols, mat.vals, options);
+                EXPECT_EQ(mat, expected) << fast_matrix_market::compression_name(compression) << " stream p=" << p;
+            }
+
+            {
+                std::ofstream f(path, std::ios_base::binary);
+                f << bytes;
+            }
+            triplet_matrix<int64_t, double> mat;
+            fast_matrix_market::read_matrix_market_triplet(path, mat.nrows, mat.ncols, mat.rows, mat.cols, mat.vals, options);
+            EXPECT_EQ(mat, expected) << fast_matrix_market::compression_name(compression) << " path p=" << p;
+        }
+    }
+
+    std::filesystem::remove(path);
+
+    std::ostringstream oss;
+    EXPECT_THROW(fast_matrix_market::compress_ostream compressed(oss, fast_matrix_market::Bzip2Compression),
+                 fast_matrix_market::invalid_argument);
+}
+#endif
+
+TEST(BinaryCache, RoundTrip) {
+    const std::string path = (std::filesystem::temp_directory_path() / "fmm_binary_cache_test.mtx").string();
+    const std::string cache_path = fast_matrix_market::binary_cache_path(path);
+
+    for (const char* name : {"kepner_gilbert_graph.mtx", "symmetry/coordinate_symmetric_row.mtx",
+                             "symmetry/coordinate_skew_symmetric_row.mtx", "eye3_pattern.mtx"}) {
+        std::filesystem::remove(cache_path);
+        std::filesystem::copy_file(kTestMatrixDir + "/" + name, path, std::filesystem::copy_options::overwrite_existing);
+
+        for (bool generalize : {true, false}) {
+            fast_matrix_market::read_options options;
+            options.generalize_symmetry = generalize;
+
+            fast_matrix_market::matrix_market_header expected_header;
+            triplet_matrix<int64_t, double> expected;
+            fast_matrix_market::read_matrix_market_triplet(path, expected_header, expected.rows, expected.cols, expected.vals, options);
+            expected.nrows = expected_header.nrows;
+            expected.ncols = expected_header.ncols;
+
+            fast_matrix_market::matrix_market_header csc_header;
+            csc_matrix<int64_t, double> expected_csc;
+            fast_matrix_market::read_matrix_market_csc(path, csc_header, expected_csc.indptr, expected_csc.indices, expected_csc.vals, options);
+
+            options.binary_cache = true;
+            // First read writes the cache, second read uses it.
+            for (int pass = 0; pass < 2; ++pass) {
+                fast_matrix_market::matrix_market_header header;
+                triplet_matrix<int64_t, double> mat;
+                fast_matrix_market::read_matrix_market_triplet(path, header, mat.rows, mat.cols, mat.vals, options);
+                mat.nrows = header.nrows;
+                mat.ncols = header.ncols;
+                EXPECT_EQ(mat, expected) << name << " generalize=" << generalize << " pass=" << pass;
+                EXPECT_EQ(header.symmetry, expected_header.symmetry);
+                EXPECT_EQ(header.comment, expected_header.comment);
+                EXPECT_TRUE(std::filesystem::exists(cache_path));
+
+                csc_matrix<int64_t, double> csc;
+                fast_matrix_market::read_matrix_market_csc(path, csc_header, csc.indptr, csc.indices, csc.vals, options);
+                EXPECT_EQ(csc.indptr, expected_csc.indptr) << name;
+                EXPECT_EQ(csc.indices, expected_csc.indices) << name;
+                EXPECT_EQ(csc.vals, expected_csc.vals) << name;
+            }
+        }
+    }
+
+    fast_matrix_market::read_options options;
+    options.binary_cache = true;
+
+    // A cache of the current file is used instead of parsing.
+    {
+        fast_matrix_market::binary_cache_key key;
+        ASSERT_TRUE(fast_matrix_market::get_binary_cache_key(path, key));
+        fast_matrix_market::matrix_market_header header(5, 6);
+        std::vector<int64_t> rows = {4}, cols = {5};
+        std::vector<double> vals = {2.5};
+        ASSERT_TRUE(fast_matrix_market::write_binary_cache(cache_path, key, header, rows.begin(), cols.begin(), vals.begin(), 1));
+
+        triplet_matrix<int64_t, double> mat;
+        fast_matrix_market::read_matrix_market_triplet(path, mat.nrows, mat.ncols, mat.rows, mat.cols, mat.vals, options);
+        EXPECT_EQ(mat.nrows, 5);
+        EXPECT_EQ(mat.rows, rows);
+        EXPECT_EQ(mat.vals, vals);
+    }
+
+    // A changed file, or a read into different types, replaces the cache.
+    std::filesystem::copy_file(kTestMatrixDir + "/nist_ex1.mtx", path, std::filesystem::copy_options::overwrite_existing);
+    {
+        triplet_matrix<int64_t, double> expected, mat;
+        read_triplet_file("nist_ex1.mtx", expected);
+        fast_matrix_market::read_matrix_market_triplet(path, mat.nrows, mat.ncols, mat.rows, mat.cols, mat.vals, options);
+        EXPECT_EQ(mat, expected);
+
+        triplet_matrix<int32_t, float> expected32, mat32;
+        read_triplet_file("nist_ex1.mtx", expected32);
+        fast_matrix_market::read_matrix_market_triplet(path, mat32.nrows, mat32.ncols, mat32.rows, mat32.cols, mat32.vals, options);
+        EXPECT_EQ(mat32, expected32);
+    }
+
+    std::filesystem::remove(path);
+    std::filesystem::remove(cache_path);
+}
+
+TEST(LineIndex, Ranges) {
+    const std::string index_path = (std::filesystem::temp_directory_path() / "fmm_line_index_test.fmmindex").string();
+
+    for (const char* name : {"kepner_gilbert_graph.mtx", "nist_ex1_more_freeformat.mtx", "vector_coordinate.mtx",
+                             "symmetry/coordinate_symmetric_row.mtx",
+                             "permissive/windows_lineendings_nist_ex1_more_freeformat.mtx"}) {
+        const std::string path = kTestMatrixDir + "/" + name;
+
+        fast_matrix_market::read_options raw_options;
+        raw_options.generalize_symmetry = false;
+        triplet_matrix<int64_t, double> expected;
+        read_triplet_file(name, expected, raw_options);
+        auto nnz = (int64_t)expected.rows.size();
+
+        for (int64_t stride : {1, 2, 3, 1000}) {
+            fast_matrix_market::read_options options;
+            options.chunk_size_bytes = 15;
+            options.num_threads = 4;
+            auto index = fast_matrix_market::build_line_index(path, stride, options);
+            EXPECT_EQ(index.num_elements, nnz) << name;
+
+            fast_matrix_market::write_line_index(index_path, index);
+            auto loaded = fast_matrix_market::read_line_index(index_path);
+            EXPECT_EQ(loaded.num_elements, index.num_elements);
+            ASSERT_EQ(loaded.entries.size(), index.entries.size());
+
+            for (int64_t first = 0; first <= nnz; ++first) {
+                for (int64_t last = first; last <= nnz; ++last) {
+                    fast_matrix_market::matrix_market_header header;
+                    triplet_matrix<int64_t, double> mat;
+                    fast_matrix_market::read_matrix_market_triplet_range(path, loaded, first, last, header,
+                                                                         mat.rows, mat.cols, mat.vals, raw_options);
+                    std::vector<int64_t> expected_rows(expected.rows.begin() + first, expected.rows.begin() + last);
+                    std::vector<double> expected_vals(expected.vals.begin() + first, expected.vals.begin() + last);
+                    EXPECT_EQ(mat.rows, expected_rows) << name << " stride=" << stride << " [" << first << ", " << last << ")";
+                    EXPECT_EQ(mat.vals, expected_vals) << name << " stride=" << stride << " [" << first << ", " << last << ")";
+                    EXPECT_EQ(header.nrows, expected.nrows);
+                }
+            }
+        }
+    }
+
+    // Symmetry is generalized per range.
+    {
+        const std::string path = kTestMatrixDir + "/symmetry/coordinate_symmetric_row.mtx";
+        triplet_matrix<int64_t, double> expected, mat;
+        read_triplet_file("symmetry/coordinate_symmetric_row.mtx", expected);
+        auto index = fast_matrix_market::build_line_index(path, 2);
+        fast_matrix_market::matrix_market_header header;
+        fast_matrix_market::read_matrix_market_triplet_range(path, index, 0, index.num_elements, header, mat.rows, mat.cols, mat.vals);
+        mat.nrows = header.nrows;
+        mat.ncols = header.ncols;
+        EXPECT_EQ(mat, expected);
+    }
+
+    {
+        const std::string path = kTestMatrixDir + "/eye3.mtx";
+        auto index = fast_matrix_market::build_line_index(path, 2);
+        triplet_matrix<int64_t, double> mat;
+        fast_matrix_market::matrix_market_header header;
+        EXPECT_THROW(fast_matrix_market::read_matrix_market_triplet_range(path, index, 0, 4, header, mat.rows, mat.cols, mat.vals),
+                     fast_matrix_market::invalid_argument);
+
+        index.key.hash ^= 1;
+        EXPECT_THROW(fast_matrix_market::read_matrix_market_triplet_range(path, index, 0, 1, header, mat.rows, mat.cols, mat.vals),
+                     fast_matrix_market::invalid_argument);
+    }
+
+    std::filesystem::remove(index_path);
+}
+
+/**
+ * Drop the elements outside a row and column window.
+ */
+template <typename IT, typename VT>
+triplet_matrix<IT, VT> window_triplet(const triplet_matrix<IT, VT>& mat, int64_t row_begin, int64_t row_end, int64_t col_begin, int64_t col_end) {
+    triplet_matrix<IT, VT> ret;
+    ret.nrows = mat.nrows;
+    ret.ncols = mat.ncols;
+    for (std::size_t i = 0; i < mat.rows.size(); ++i) {
+        if (mat.rows[i] >= row_begin && mat.rows[i] < row_end && mat.cols[i] >= col_begin && mat.cols[i] < col_end) {
+            ret.rows.push_back(mat.rows[i]);
+            ret.cols.push_back(mat.cols[i]);
+            ret.vals.push_back(mat.vals[i]);
+        }
+    }
+    return ret;
+}
+
+template <typename IT, typename VT>
+std::vector<std::tuple<IT, IT, VT>> sorted_elements(const triplet_matrix<IT, VT>& mat) {
+    std::vector<std::tuple<IT, IT, VT>> ret;
+    for (std::size_t i = 0; i < mat.rows.size(); ++i) {
+        ret.emplace_back(mat.rows[i], mat.cols[i], mat.vals[i]);
+    }
+    std::sort(ret.begin(), ret.end());
+    return ret;
+}
+
+TEST(WindowFilter, Triplet) {
+    struct window { int64_t row_begin, row_end, col_begin, col_end; };
+    for (const char* name : {"kepner_gilbert_graph.mtx", "nist_ex1.mtx", "symmetry/coordinate_symmetric_row.mtx",
+                             "symmetry/coordinate_skew_symmetric_row.mtx", "eye3_array.mtx"}) {
+        triplet_matrix<int64_t, double> full;
+        read_triplet_file(name, full);
+        bool general = read_header_file(name).symmetry == fast_matrix_market::general;
+
+        for (auto w : {window{0, -1, 0, -1}, window{1, 3, 0, -1}, window{0, -1, 2, 4}, window{2, 5, 1, 3}, window{100, 200, 0, -1}}) {
+            auto expected = window_triplet(full, w.row_begin, w.row_end < 0 ? INT64_MAX : w.row_end,
+                                           w.col_begin, w.col_end < 0 ? INT64_MAX : w.col_end);
+
+            for (int chunk_size : {1, 15, 1000}) {
+                for (int p : {1, 4}) {
+                    for (bool fused : {false, true}) {
+                        fast_matrix_market::read_options options;
+                        options.chunk_size_bytes = chunk_size;
+                        options.num_threads = p;
+                        options.fused_count_parse = fused;
+                        options.filter_row_begin = w.row_begin;
+                        options.filter_row_end = w.row_end;
+                        options.filter_col_begin = w.col_begin;
+                        options.filter_col_end = w.col_end;
+
+                        triplet_matrix<int64_t, double> mat;
+                        read_triplet_mapped_file(name, mat, options);
+                        if (general) {
+                            // File order is kept.
+                            EXPECT_EQ(mat, expected) << name << " chunk_size=" << chunk_size << " p=" << p;
+                        } else {
+                            EXPECT_EQ(sorted_elements(mat), sorted_elements(expected)) << name << " chunk_size=" << chunk_size << " p=" << p;
+                        }
+                    }
+                }
+            }
+        }
+    }
+}
+
+TEST(Batches, MatchesTriplet) {
+    for (const char* name : {"kepner_gilbert_graph.mtx", "nist_ex1.mtx", "eye3_pattern.mtx", "vector_coordinate.mtx",
+                             "symmetry/coordinate_symmetric_row.mtx", "symmetry/coordinate_skew_symmetric_row.mtx"}) {
+        triplet_matrix<int64_t, double> expected;
+        read_triplet_file(name, expected);
+        bool general = read_header_file(name).symmetry == fast_matrix_market::general;
+        bool pattern = read_header_file(name).field == fast_matrix_market::pattern;
+
+        for (int chunk_size : {1, 15, 1000}) {
+            for (int p : {1, 4}) {
+                fast_matrix_market::read_options options;
+                options.chunk_size_bytes = chunk_size;
+                options.num_threads = p;
+
+                triplet_matrix<int64_t, double> mat;
+                int64_t num_batches = 0;
+                std::ifstream f(kTestMatrixDir + "/" + name);
+                fast_matrix_market::matrix_market_header header;
+                fast_matrix_market::read_matrix_market_batches<int64_t, double>(f, header, [&](const auto& batch) {
+                    EXPECT_EQ(batch.first_element, (int64_t)mat.rows.size());
+                    EXPECT_EQ(batch.values.size(), pattern ? 0 : batch.size());
+                    mat.rows.insert(mat.rows.end(), batch.rows.begin(), batch.rows.end());
+                    mat.cols.insert(mat.cols.end(), batch.cols.begin(), batch.cols.end());
+                    if (pattern) {
+                        mat.vals.insert(mat.vals.end(), batch.size(), 1.0);
+                    } else {
+                        mat.vals.insert(mat.vals.end(), batch.values.begin(), batch.values.end());
+                    }
+                    ++num_batches;
+                }, options);
+                mat.nrows = header.nrows;
+                mat.ncols = header.ncols;
+
+                if (general) {
+                    EXPECT_EQ(mat, expected) << name << " chunk_size=" << chunk_size << " p=" << p;
+                } else {
+                    EXPECT_EQ(sorted_elements(mat), sorted_elements(expected)) << name << " chunk_size=" << chunk_size << " p=" << p;
+                }
+                if (chunk_size == 1) {
+                    EXPECT_GT(num_batches, 1);
+                }
+            }
+        }
+    }
+
+    std::ifstream f(kTestMatrixDir + "/eye3_array.mtx");
+    fast_matrix_market::matrix_market_header header;
+    auto ignore = [](const auto&) {};
+    EXPECT_THROW((fast_matrix_market::read_matrix_market_batches<int64_t, double>(f, header, ignore)),
+                 fast_matrix_market::invalid_argument);
+}
+
+TEST(InflightBudget, ReadWrite) {
+    triplet_matrix<int64_t, double> mat;
+    mat.nrows = mat.ncols = 1000;
+    for (int64_t i = 0; i < 4000; ++i) {
+        mat.rows.push_back(i % 1000);
+        mat.cols.push_back((i * 7) % 1000);
+        mat.vals.push_back((double)i / 3);
+    }
+
+    const int64_t chunk_bytes = 512;
+    std::string expected_str;
+    for (int64_t budget : {(int64_t)0, (int64_t)1, 4 * chunk_bytes}) {
+        fast_matrix_market::write_options write_options;
+        write_options.num_threads = 8;
+        write_options.chunk_size_values = 100;
+        write_options.max_inflight_bytes = budget;
+        write_options.stats = std::make_shared<fast_matrix_market::pipeline_stats>();
+
+        std::ostringstream oss;
+        fast_matrix_market::write_matrix_market_triplet(oss, {mat.nrows, mat.ncols}, mat.rows, mat.cols, mat.vals, write_options);
+        if (budget == 0) {
+            expected_str = oss.str();
+        } else {
+            EXPECT_EQ(oss.str(), expected_str) << "budget=" << budget;
+        }
+        EXPECT_GT(write_options.stats->peak_inflight_bytes, 0);
+
+        for (bool fused : {false, true}) {
+            fast_matrix_market::read_options options;
+            options.num_threads = 8;
+            options.chunk_size_bytes = chunk_bytes;
+            options.fused_count_parse = fused;
+            options.max_inflight_bytes = budget;
+            options.stats = std::make_shared<fast_matrix_market::pipeline_stats>();
+
+            triplet_matrix<int64_t, double> result;
+            std::istringstream iss(expected_str);
+            fast_matrix_market::read_matrix_market_triplet(iss, result.nrows, result.ncols, result.rows, result.cols, result.vals, options);
+            EXPECT_EQ(result, mat) << "budget=" << budget << " fused=" << fused;
+
+            auto peak = options.stats->peak_inflight_bytes;
+            EXPECT_GT(peak, 0);
+            if (budget == 1) {
+                // A single chunk at a time.
+                EXPECT_LT(peak, (fused ? 8 : 2) * chunk_bytes) << "fused=" << fused;
+            } else if (budget > 1 && !fused) {
+                EXPECT_LE(peak, budget + chunk_bytes);
+            }
+        }
+    }
+}
+
+TEST(BufferPool, ReusedAcrossCalls) {
+    triplet_matrix<int64_t, double> mat;
+    mat.nrows = mat.ncols = 100;
+    for (int64_t i = 0; i < 10000; ++i) {
+        mat.rows.push_back(i % 100);
+        mat.cols.push_back((i * 7) % 100);
+        mat.vals.push_back((double)i / 3);
+    }
+
+    const int p = 4;
+    const int rounds = 10;
+    for (bool huge_pages : {false, true}) {
+        auto pool = std::make_shared<fast_matrix_market::chunk_buffer_pool>(64, huge_pages);
+
+        std::string expected_str;
+        for (int round = 0; round < rounds; ++round) {
+            fast_matrix_market::write_options write_options;
+            write_options.num_threads = p;
+            write_options.chunk_size_values = 500;
+            write_options.buffer_pool = pool;
+
+            std::ostringstream oss;
+            fast_matrix_market::write_matrix_market_triplet(oss, {mat.nrows, mat.ncols}, mat.rows, mat.cols, mat.vals, write_options);
+            if (round == 0) {
+                expected_str = oss.str();
+            } else {
+                EXPECT_EQ(oss.str(), expected_str);
+            }
+
+            for (bool fused : {false, true}) {
+                fast_matrix_market::read_options options;
+                options.num_threads = p;
+                options.chunk_size_bytes = 8192;
+                options.fused_count_parse = fused;
+                options.buffer_pool = pool;
+
+                triplet_matrix<int64_t, double> result;
+                std::istringstream iss(expected_str);
+                fast_matrix_market::read_matrix_market_triplet(iss, result.nrows, result.ncols, result.rows, result.cols, result.vals, options);
+                EXPECT_EQ(result, mat) << "fused=" << fused;
+            }
+        }
+
+        // Each call returns its buffers, so new ones are only needed for more chunks in flight than ever before.
+        // That is bounded by the pipelines' in-flight limits, not by the number of chunks or calls.
+        int64_t in_flight_bound = (2 * p + 2) + 2 * (2 * p + 2);
+        EXPECT_LE(pool->get_num_misses(), in_flight_bound);
+        EXPECT_GT(pool->get_num_idle(), 0);
+    }
+}
+
+TEST(PipelineStats, ReadWrite) {
+    using fast_matrix_market::pipeline_stats;
+    triplet_matrix<int64_t, double> mat;
+    mat.nrows = mat.ncols = 100;
+    for (int64_t i = 0; i < 2000; ++i) {
+        mat.rows.push_back(i % 100);
+        mat.cols.push_back((i * 7) % 100);
+        mat.vals.push_back((double)i / 3);
+    }
+
+    fast_matrix_market::write_options write_options;
+    write_options.num_threads = 4;
+    write_options.chunk_size_values = 100;
+    write_options.stats = std::make_shared<pipeline_stats>();
+
+    std::ostringstream oss;
+    fast_matrix_market::write_matrix_market_triplet(oss, {mat.nrows, mat.ncols}, mat.rows, mat.cols, mat.vals, write_options);
+    const std::string mtx = oss.str();
+
+    std::size_t body_bytes;
+    {
+        std::istringstream iss(mtx);
+        fast_matrix_market::matrix_market_header header;
+        fast_matrix_market::read_header(iss, header);
+        body_bytes = mtx.size() - (std::size_t)iss.tellg();
+    }
+
+    const auto& ws = *write_options.stats;
+    EXPECT_EQ(ws.chunks, 20);
+    EXPECT_EQ(ws.bytes, (int64_t)body_bytes);
+    EXPECT_EQ(ws.stages[fast_matrix_market::stage_format].count, ws.chunks);
+    EXPECT_EQ(ws.stages[fast_matrix_market::stage_write].count, ws.chunks);
+    EXPECT_EQ(ws.stages[fast_matrix_market::stage_parse].count, 0);
+    EXPECT_GT(ws.wall_ns, 0);
+
+    for (bool fused : {false, true}) {
+        fast_matrix_market::read_options options;
+        options.num_threads = 4;
+        options.chunk_size_bytes = 1024;
+        options.fused_count_parse = fused;
+        options.stats = std::make_shared<pipeline_stats>();
+
+        // Measurements add up over calls.
+        for (int round = 1; round <= 2; ++round) {
+            triplet_matrix<int64_t, double> result;
+            std::istringstream iss(mtx);
+            fast_matrix_market::read_matrix_market_triplet(iss, result.nrows, result.ncols, result.rows, result.cols, result.vals, options);
+            EXPECT_EQ(result, mat);
+
+            const auto& rs = *options.stats;
+            EXPECT_EQ(rs.bytes, round * (int64_t)body_bytes) << "fused=" << fused;
+            EXPECT_GT(rs.chunks, round);
+            EXPECT_EQ(rs.stages[fast_matrix_market::stage_read].count, rs.chunks);
+            EXPECT_EQ(rs.stages[fast_matrix_market::stage_parse].count, rs.chunks);
+            EXPECT_EQ(rs.stages[fast_matrix_market::stage_line_count].count, fused ? 0 : rs.chunks);
+            EXPECT_EQ(rs.stages[fast_matrix_market::stage_copy].count, fused ? rs.chunks : 0);
+            EXPECT_GT(rs.stages[fast_matrix_market::stage_parse].wall_ns, 0);
+        }
+    }
+
+    // Application stages.
+    {
+        fast_matrix_market::read_options options;
+        options.stats = std::make_shared<pipeline_stats>();
+        std::istringstream iss(mtx);
+        fast_matrix_market::matrix_market_header header;
+        std::vector<int64_t> indptr, indices;
+        std::vector<double> values;
+        fast_matrix_market::read_matrix_market_csr(iss, header, indptr, indices, values, options);
+        EXPECT_EQ(options.stats->stages[fast_matrix_market::stage_convert].count, 1);
+    }
+    {
+        fast_matrix_market::read_options options;
+        options.stats = std::make_shared<pipeline_stats>();
+        options.generalize_symmetry = true;
+        options.generalize_symmetry_app = true;
+        std::ifstream f(kTestMatrixDir + "/symmetry/coordinate_symmetric_row.mtx");
+        triplet_matrix<int64_t, double> result;
+        fast_matrix_market::read_matrix_market_triplet(f, result.nrows, result.ncols, result.rows, result.cols, result.vals, options);
+        EXPECT_EQ(options.stats->stages[fast_matrix_market::stage_generalize_symmetry].count, 1);
+    }
+}
+
+TEST(Progress, ReportAndCancel) {
+    using fast_matrix_market::progress_info;
+    triplet_matrix<int64_t, double> mat;
+    mat.nrows = mat.ncols = 100;
+    for (int64_t i = 0; i < 2000; ++i) {
+        mat.rows.push_back(i % 100);
+        mat.cols.push_back((i * 7) % 100);
+        mat.vals.push_back((double)i / 3);
+    }
+
+    std::string mtx;
+    std::size_t body_bytes;
+    {
+        std::ostringstream oss;
+        fast_matrix_market::write_matrix_market_triplet(oss, {mat.nrows, mat.ncols}, mat.rows, mat.cols, mat.vals);
+        mtx = oss.str();
+        std::istringstream iss(mtx);
+        fast_matrix_market::matrix_market_header header;
+        fast_matrix_market::read_header(iss, header);
+        body_bytes = mtx.size() - (std::size_t)iss.tellg();
+    }
+
+    // Calls the callback returned, and the totals it saw last.
+    int64_t num_calls = 0;
+    progress_info last;
+    auto track = [&](int64_t cancel_after) {
+        num_calls = 0;
+        last = {};
+        return [&, cancel_after](const progress_info& progress) {
+            EXPECT_GT(progress.chunks, last.chunks);
+            EXPECT_GE(progress.bytes, last.bytes);
+            last = progress;
+            return ++num_calls != cancel_after;
+        };
+    };
+
+    auto shared_pool = std::make_shared<task_thread_pool::task_thread_pool>(4);
+    for (int num_threads : {1, 4}) {
+        for (bool fused : {false, true}) {
+            fast_matrix_market::read_options options;
+            options.num_threads = num_threads;
+            options.chunk_size_bytes = 1024;
+            options.fused_count_parse = fused;
+            if (num_threads > 1) {
+                options.thread_pool = shared_pool;
+            }
+
+            options.progress_callback = track(-1);
+            triplet_matrix<int64_t, double> result;
+            std::istringstream iss(mtx);
+            fast_matrix_market::read_matrix_market_triplet(iss, result.nrows, result.ncols, result.rows, result.cols, result.vals, options);
+            EXPECT_EQ(result, mat);
+            EXPECT_EQ(last.bytes, (int64_t)body_bytes);
+            EXPECT_EQ(last.elements, (int64_t)mat.rows.size());
+            EXPECT_EQ(last.chunks, num_calls);
+            EXPECT_GT(num_calls, 2);
+
+            options.progress_callback = track(2);
+            std::istringstream cancel_iss(mtx);
+            EXPECT_THROW(fast_matrix_market::read_matrix_market_triplet(cancel_iss, result.nrows, result.ncols, result.rows, result.cols, result.vals, options),
+                         fast_matrix_market::operation_cancelled);
+            EXPECT_EQ(num_calls, 2) << "num_threads=" << num_threads << " fused=" << fused;
+        }
+
+        const std::string path = (std::filesystem::temp_directory_path() / "fmm_progress_test.mtx").string();
+        for (bool to_file : {false, true}) {
+            fast_matrix_market::write_options options;
+            options.num_threads = num_threads;
+            options.chunk_size_values = 100;
+            if (num_threads > 1) {
+                options.thread_pool = shared_pool;
+            }
+
+            options.progress_callback = track(-1);
+            if (to_file) {
+                fast_matrix_market::write_matrix_market_triplet(path, {mat.nrows, mat.ncols}, mat.rows, mat.cols, mat.vals, options);
+                EXPECT_EQ(read_file_bytes(path), mtx);
+            } else {
+                std::ostringstream oss;
+                fast_matrix_market::write_matrix_market_triplet(oss, {mat.nrows, mat.ncols}, mat.rows, mat.cols, mat.vals, options);
+                EXPECT_EQ(oss.str(), mtx);
+            }
+            EXPECT_EQ(last.bytes, (int64_t)body_bytes);
+            EXPECT_EQ(last.elements, (int64_t)mat.rows.size());
+            EXPECT_EQ(num_calls, 20);
+
+            options.progress_callback = track(2);
+            if (to_file) {
+                EXPECT_THROW(fast_matrix_market::write_matrix_market_triplet(path, {mat.nrows, mat.ncols}, mat.rows, mat.cols, mat.vals, options),
+                             fast_matrix_market::operation_cancelled);
+            } else {
+                std::ostringstream oss;
+                EXPECT_THROW(fast_matrix_market::write_matrix_market_triplet(oss, {mat.nrows, mat.ncols}, mat.rows, mat.cols, mat.vals, options),
+                             fast_matrix_market::operation_cancelled);
+            }
+            EXPECT_EQ(num_calls, 2) << "num_threads=" << num_threads << " to_file=" << to_file;
+        }
+    }
+
+    // A cancelled call leaves a shared pool usable.
+    auto future = shared_pool->submit([] { return 1; });
+    EXPECT_EQ(future.get(), 1);
+}
+
+TEST(ThreadPool, Shared) {
+    auto pool = std::make_shared<task_thread_pool::task_thread_pool>(2);
+
+    triplet_matrix<int64_t, double> expected;
+    read_triplet_file("kepner_gilbert_graph.mtx", expected);
+
+    for (int i = 0; i < 3; ++i) {
+        fast_matrix_market::read_options options;
+        options.thread_pool = pool;
+        options.chunk_size_bytes = 15;
+
+        triplet_matrix<int64_t, double> mat;
+        std::ifstream f(kTestMatrixDir + "/kepner_gilbert_graph.mtx");
+        fast_matrix_market::read_matrix_market_triplet(f, mat.nrows, mat.ncols, mat.rows, mat.cols, mat.vals, options);
+        EXPECT_EQ(mat, expected);
+
+        fast_matrix_market::write_options write_options;
+        write_options.thread_pool = pool;
+        write_options.chunk_size_values = 1;
+
+        std::ostringstream oss, expected_oss;
+        fast_matrix_market::write_matrix_market_triplet(oss, {mat.nrows, mat.ncols}, mat.rows, mat.cols, mat.vals, write_options);
+        write_options.thread_pool = nullptr;
+        write_options.parallel_ok = false;
+        fast_matrix_market::write_matrix_market_triplet(expected_oss, {mat.nrows, mat.ncols}, mat.rows, mat.cols, mat.vals, write_options);
+        EXPECT_EQ(oss.str(), expected_oss.str());
+    }
+
+    // Errors must leave the shared pool usable.
+    {
+        fast_matrix_market::read_options options;
+        options.thread_pool = pool;
+        options.chunk_size_bytes = 1;
+
+        triplet_matrix<int64_t, double> mat;
+        std::istringstream iss("%%MatrixMarket matrix coordinate real general\n3 3 3\n1 1 1\n2 2 2\n3 3 x\n");
+        EXPECT_THROW(fast_matrix_market::read_matrix_market_triplet(iss, mat.nrows, mat.ncols, mat.rows, mat.cols, mat.vals, options),
+                     fast_matrix_market::invalid_mm);
+    }
+    EXPECT_EQ(pool->submit([] { return 1; }).get(), 1);
+
+    // The default pool is reused across calls.
+    EXPECT_EQ(&fast_matrix_market::default_thread_pool(), &fast_matrix_market::default_thread_pool());
+}
+
+TEST(ThreadPool, WorkStealing) {
+    {
+        std::atomic<int> sum{0};
+        {
+            fast_matrix_market::work_stealing_thread_pool pool(4);
+            std::vector<std::future<void>> futures;
+            for (int i = 0; i < 1000; ++i) {
+                futures.push_back(pool.submit([&pool, &sum, i] {
+                    // tasks submitted from inside the pool go to the worker's own deque
+                    pool.submit_detach([&sum, i] { sum += i; });
+                }));
+            }
+            for (auto& f : futures) {
+                f.get();
+            }
+            EXPECT_EQ(pool.submit([] { return 7; }).get(), 7);
+        }
+        // the destructor runs all remaining tasks
+        EXPECT_EQ(sum, 999 * 1000 / 2);
+    }
+
+    triplet_matrix<int64_t, double> expected;
+    read_triplet_file("kepner_gilbert_graph.mtx", expected);
+
+    for (int num_threads : {0, 3}) {
+        for (bool fused : {false, true}) {
+            fast_matrix_market::read_options options;
+            options.pool_type = fast_matrix_market::WorkStealingPool;
+            options.num_threads = num_threads;
+            options.chunk_size_bytes = 1;
+            options.fused_count_parse = fused;
+
+            triplet_matrix<int64_t, double> mat;
+            std::ifstream f(kTestMatrixDir + "/kepner_gilbert_graph.mtx");
+            fast_matrix_market::read_matrix_market_triplet(f, mat.nrows, mat.ncols, mat.rows, mat.cols, mat.vals, options);
+            EXPECT_EQ(mat, expected) << "num_threads=" << num_threads << " fused=" << fused;
+        }
+
+        fast_matrix_market::write_options options;
+        options.pool_type = fast_matrix_market::WorkStealingPool;
+        options.num_threads = num_threads;
+        options.chunk_size_values = 1;
+
+        std::ostringstream oss, expected_oss;
+        fast_matrix_market::write_matrix_market_triplet(oss, {expected.nrows, expected.ncols}, expected.rows, expected.cols, expected.vals, options);
+        options.parallel_ok = false;
+        fast_matrix_market::write_matrix_market_triplet(expected_oss, {expected.nrows, expected.ncols}, expected.rows, expected.cols, expected.vals, options);
+        EXPECT_EQ(oss.str(), expected_oss.str());
+
+        // pwrite tasks wait on the previous chunk's offset
+        options.parallel_ok = true;
+        const std::string path = (std::filesystem::temp_directory_path() / "fmm_work_stealing_test.mtx").string();
+        fast_matrix_market::write_matrix_market_triplet(path, {expected.nrows, expected.ncols}, expected.rows, expected.cols, expected.vals, options);
+        EXPECT_EQ(read_file_bytes(path), expected_oss.str());
+        std::filesystem::remove(path);
+    }
+}
+
 TEST(Generator, Generator) {
     {
         // Generate a 3x3 identity matrix
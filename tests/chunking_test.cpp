@@ -2,6 +2,7 @@
 // Use of this source code is governed by the BSD 2-clause license found in the LICENSE.txt file.
 // SPDX-License-Identifier: BSD-2-Clause
 
+#include <random>
 #include <sstream>
 
 #include "fmm_tests.hpp"
@@ -33,6 +34,44 @@ std::string chunk_and_recombine(const std::string& s, int chunk_size) {
     return recombined;
 }
 
+std::string chunk_and_recombine_memory(const std::string& s, int chunk_size) {
+    std::string recombined;
+
+    fast_matrix_market::memory_streambuf membuf(s.data(), s.data() + s.size());
+    std::istream instream(&membuf);
+    fast_matrix_market::read_options options;
+    options.chunk_size_bytes = chunk_size;
+
+    fast_matrix_market::chunk_reader reader(instream, options);
+    std::string buffer;
+    while (reader.has_next()) {
+        std::string_view chunk = reader.next_chunk(buffer);
+        if (!chunk.empty() && chunk.data() != buffer.data()) {
+            // chunks that are views into memory must end on a line boundary
+            EXPECT_EQ(chunk.back(), '\n');
+        }
+        recombined += chunk;
+    }
+
+    return recombined;
+}
+
+std::string split_and_recombine(const std::string& s, int chunk_size) {
+    std::string recombined;
+
+    auto range_size = (std::size_t)std::max(chunk_size, 1);
+    for (std::size_t range = 0; range * range_size < s.size(); ++range) {
+        std::string buffer;
+        std::string_view chunk = fast_matrix_market::get_range_chunk(buffer, s, range, range_size);
+        if (!chunk.empty() && chunk.data() != buffer.data()) {
+            EXPECT_EQ(chunk.back(), '\n');
+        }
+        recombined += chunk;
+    }
+
+    return recombined;
+}
+
 class ChunkingSuite : public testing::TestWithParam<int> {
 public:
     struct PrintToStringParamName
@@ -53,6 +92,22 @@ TEST_P(ChunkingSuite, Small) {
     EXPECT_EQ(short_s, chunk_and_recombine(short_s, GetParam()));
 }
 
+TEST_P(ChunkingSuite, Ranges) {
+    EXPECT_EQ(empty, split_and_recombine(empty, GetParam()));
+    EXPECT_EQ(newline_only, split_and_recombine(newline_only, GetParam()));
+    EXPECT_EQ(one_line_no_newline, split_and_recombine(one_line_no_newline, GetParam()));
+    EXPECT_EQ(one_line_newline, split_and_recombine(one_line_newline, GetParam()));
+    EXPECT_EQ(short_s, split_and_recombine(short_s, GetParam()));
+}
+
+TEST_P(ChunkingSuite, Memory) {
+    EXPECT_EQ(empty, chunk_and_recombine_memory(empty, GetParam()));
+    EXPECT_EQ(newline_only, chunk_and_recombine_memory(newline_only, GetParam()));
+    EXPECT_EQ(one_line_no_newline, chunk_and_recombine_memory(one_line_no_newline, GetParam()));
+    EXPECT_EQ(one_line_newline, chunk_and_recombine_memory(one_line_newline, GetParam()));
+    EXPECT_EQ(short_s, chunk_and_recombine_memory(short_s, GetParam()));
+}
+
 INSTANTIATE_TEST_SUITE_P(Chunking, ChunkingSuite, testing::Range(0, 10),
                          ChunkingSuite::PrintToStringParamName());
 
@@ -83,3 +138,41 @@ TEST(LineCount, LineCount) {
     EXPECT_EQ(fast_matrix_market::count_lines("aa\n\n"), make_i64_pair(2, 1));
     EXPECT_EQ(fast_matrix_market::count_lines("aa\n\n\n"), make_i64_pair(3, 2));
 }
+
+TEST(LineCount, Kernels) {
+    std::vector<std::pair<std::string, fast_matrix_market::simd::count_lines_kernel>> kernels = {
+        {"dispatch", fast_matrix_market::count_lines},
+#ifdef FMM_SIMD_SSE2
+        {"sse2", fast_matrix_market::simd::count_lines_sse2},
+#endif
+#ifdef FMM_SIMD_AVX2
+        {"avx2", fast_matrix_market::simd::count_lines_avx2},
+#endif
+#ifdef FMM_SIMD_NEON
+        {"neon", fast_matrix_market::simd::count_lines_neon},
+#endif
+    };
+
+    std::mt19937 gen(1234);
+    const std::string alphabet = "\n\n  \t\r12.e-";
+    std::uniform_int_distribution<std::size_t> char_dist(0, alphabet.size() - 1);
+
+    for (std::size_t length = 0; length < 300; ++length) {
+        for (int rep = 0; rep < 10; ++rep) {
+            std::string s;
+            for (std::size_t i = 0; i < length; ++i) {
+                s += alphabet[char_dist(gen)];
+            }
+
+            auto expected = fast_matrix_market::count_lines_scalar(s);
+            for (const auto& [name, kernel] : kernels) {
+#ifdef FMM_SIMD_AVX2
+                if (name == "avx2" && !fast_matrix_market::simd::cpu_has_avx2()) {
+                    continue;
+                }
+#endif
+                EXPECT_EQ(kernel(s), expected) << name << " on \"" << s << "\"";
+            }
+        }
+    }
+}
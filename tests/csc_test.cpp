@@ -116,3 +116,59 @@ TYPED_TEST(CSCTest, Generated) {
         }
     }
 }
+
+TYPED_TEST(CSCTest, ReadCompressed) {
+    for (int nnz : {0, 10, 1000}) {
+        for (int ncols : {1000, 10}) {
+            for (int p : {1, 4}) {
+                this->load(nnz, 1 << 10, p);
+                construct_csc(this->mat, this->triplet, nnz, ncols);
+                auto mtx = write_mtx(this->mat, this->woptions);
+
+                // CSC reproduces the constructed matrix.
+                {
+                    std::istringstream iss(mtx);
+                    fast_matrix_market::matrix_market_header header;
+                    csc_matrix<int64_t, TypeParam> b;
+                    fast_matrix_market::read_matrix_market_csc(iss, header, b.indptr, b.indices, b.vals, this->roptions);
+                    EXPECT_EQ(this->mat.indptr, b.indptr);
+                    EXPECT_EQ(this->mat.indices, b.indices);
+                    EXPECT_EQ(this->mat.vals, b.vals);
+                }
+
+                // Each row has exactly one element, in triplet order.
+                {
+                    std::istringstream iss(mtx);
+                    fast_matrix_market::matrix_market_header header;
+                    csc_matrix<int64_t, TypeParam> b;
+                    fast_matrix_market::read_matrix_market_csr(iss, header, b.indptr, b.indices, b.vals, this->roptions);
+                    ASSERT_EQ(b.indptr.size(), (std::size_t)header.nrows + 1);
+                    for (int64_t row = 0; row <= header.nrows; ++row) {
+                        EXPECT_EQ(b.indptr[row], row);
+                    }
+                    EXPECT_EQ(this->triplet.cols, b.indices);
+                    EXPECT_EQ(this->triplet.vals, b.vals);
+                }
+            }
+        }
+    }
+}
+
+TEST(CSCRead, Symmetric) {
+    std::string mtx = "%%MatrixMarket matrix coordinate real symmetric\n"
+                      "4 4 4\n"
+                      "1 1 1\n"
+                      "3 1 2\n"
+                      "4 2 3\n"
+                      "4 3 4\n";
+
+    std::istringstream iss(mtx);
+    fast_matrix_market::matrix_market_header header;
+    std::vector<int> indptr, indices;
+    std::vector<double> vals;
+    fast_matrix_market::read_matrix_market_csr(iss, header, indptr, indices, vals);
+
+    EXPECT_EQ(indptr, std::vector<int>({0, 2, 3, 5, 7}));
+    EXPECT_EQ(indices, std::vector<int>({0, 2, 3, 0, 3, 1, 2}));
+    EXPECT_EQ(vals, std::vector<double>({1, 2, 3, 2, 4, 3, 4}));
+}
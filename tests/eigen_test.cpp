@@ -166,3 +166,28 @@ TEST(EigenTest, Symmetric) {
     }
     EXPECT_TRUE(expected.isApprox(sym, 1e-6));
 }
+
+TEST(EigenTest, Duplicates) {
+    std::string mtx = "%%MatrixMarket matrix coordinate real general\n"
+                      "3 3 6\n"
+                      "3 1 1\n"
+                      "1 2 2\n"
+                      "3 1 3\n"
+                      "2 2 4\n"
+                      "1 1 5\n"
+                      "1 2 6\n";
+
+    // Eigen sums duplicates
+    std::vector<Eigen::Triplet<VT>> triplets = {{2, 0, 1}, {0, 1, 2}, {2, 0, 3}, {1, 1, 4}, {0, 0, 5}, {0, 1, 6}};
+    SpColMajor expected(3, 3);
+    expected.setFromTriplets(triplets.begin(), triplets.end());
+
+    auto col_major = read_mtx<SpColMajor>(mtx);
+    EXPECT_TRUE(col_major.isCompressed());
+    EXPECT_EQ(col_major.nonZeros(), expected.nonZeros());
+    EXPECT_TRUE(expected.isApprox(col_major, 1e-6));
+
+    auto row_major = read_mtx<SpRowMajor>(mtx);
+    EXPECT_EQ(row_major.nonZeros(), expected.nonZeros());
+    EXPECT_TRUE(SpRowMajor(expected).isApprox(row_major, 1e-6));
+}
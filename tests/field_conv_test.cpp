@@ -181,6 +181,59 @@ TYPED_TEST(ReadInt, Integer) {
     EXPECT_EQ(i, 8);
 }
 
+TYPED_TEST(ReadInt, Simd) {
+    // Digit runs of every length, followed by various terminators and padded so the SIMD method may apply.
+    for (int num_digits = 1; num_digits <= 20; ++num_digits) {
+        for (const char* terminator : {" ", "\n", "\t", "x", ""}) {
+            for (char first : {'1', '9', '0'}) {
+                std::string digits(num_digits, '7');
+                digits[0] = first;
+                std::string s = digits + terminator + "                ";
+                const char* s_end = s.c_str() + s.size();
+
+                TypeParam expected = 0, simd_val = 0, val = 0;
+                bool expected_valid = true;
+                const char* expected_end = nullptr;
+                try {
+#ifdef FMM_FROM_CHARS_INT_SUPPORTED
+                    expected_end = fmm::read_int_from_chars(s.c_str(), s_end, expected);
+#else
+                    expected_end = fmm::read_int_fallback(s.c_str(), s_end, expected);
+#endif
+                } catch (fmm::out_of_range&) {
+                    expected_valid = false;
+                }
+
+                const char* simd_end = fmm::read_int_simd(s.c_str(), s_end, simd_val);
+                if (simd_end != nullptr) {
+                    EXPECT_TRUE(expected_valid) << s;
+                    EXPECT_EQ(simd_end, expected_end) << s;
+                    EXPECT_EQ(simd_val, expected) << s;
+                }
+
+                if (expected_valid) {
+                    EXPECT_EQ(fmm::read_int(s.c_str(), s_end, val), expected_end) << s;
+                    EXPECT_EQ(val, expected) << s;
+                } else {
+                    EXPECT_THROW(fmm::read_int(s.c_str(), s_end, val), fmm::out_of_range) << s;
+                }
+            }
+        }
+    }
+
+    // Invalid values must keep their error messages.
+    std::string invalid("asdf                ");
+    TypeParam i;
+    EXPECT_EQ(fmm::read_int_simd(invalid.c_str(), invalid.c_str() + invalid.size(), i), nullptr);
+    EXPECT_THROW(fmm::read_int(invalid.c_str(), invalid.c_str() + invalid.size(), i), fmm::invalid_mm);
+
+#ifdef FMM_SIMD_SSSE3
+    // Short digit runs must use the SIMD method if the CPU supports it.
+    std::string eight("8                   ");
+    EXPECT_EQ(fmm::read_int_simd(eight.c_str(), eight.c_str() + eight.size(), i) != nullptr, fmm::simd::cpu_has_ssse3());
+#endif
+}
+
 TEST(ReadOverflow, Integer) {
     int8_t i8;
     int32_t i32;
@@ -310,4 +363,38 @@ TEST(ReadOverflow, Float) {
     EXPECT_THROW(fmm::read_float_fallback(over_ld.c_str(), over_ld.c_str() + over_ld.size(), f, fast_matrix_market::ThrowOutOfRange), fmm::out_of_range);
     EXPECT_THROW(fmm::read_float_fallback(over_ld.c_str(), over_ld.c_str() + over_ld.size(), d, fast_matrix_market::ThrowOutOfRange), fmm::out_of_range);
     EXPECT_THROW(fmm::read_float_fallback(over_ld.c_str(), over_ld.c_str() + over_ld.size(), ld, fast_matrix_market::ThrowOutOfRange), fmm::out_of_range);
-}
\ No newline at end of file
+}
+template <typename T>
+std::string value_to_chars_string(const T& value, int precision) {
+    std::string buffer(fmm::value_chars_bound<T>(precision), '#');
+    char* end = fmm::value_to_chars(buffer.data(), value, precision);
+    EXPECT_LE(end - buffer.data(), (std::ptrdiff_t)buffer.size());
+    buffer.resize(end - buffer.data());
+    return buffer;
+}
+
+TEST(ValueToChars, MatchesString) {
+    for (int precision : {-1, 0, 1, 6, 17, 40}) {
+        for (int64_t i : {(int64_t)0, (int64_t)-1, (int64_t)42, std::numeric_limits<int64_t>::max(), std::numeric_limits<int64_t>::min()}) {
+            EXPECT_EQ(fmm::value_to_string(i, precision), value_to_chars_string(i, precision));
+        }
+        for (uint64_t i : {(uint64_t)0, std::numeric_limits<uint64_t>::max()}) {
+            EXPECT_EQ(fmm::value_to_string(i, precision), value_to_chars_string(i, precision));
+        }
+        EXPECT_EQ(fmm::value_to_string(true, precision), value_to_chars_string(true, precision));
+
+        if (fmm::value_chars_bound<double>(precision) == 0) {
+            continue;
+        }
+        for (double d : {0.0, -0.0, 1.0, -1.5, 0.1, 1e-300, 1e300, 123456789.123456789, -std::numeric_limits<double>::max(),
+                         std::numeric_limits<double>::denorm_min(), std::numeric_limits<double>::infinity()}) {
+            EXPECT_EQ(fmm::value_to_string(d, precision), value_to_chars_string(d, precision));
+
+            auto f = static_cast<float>(d);
+            EXPECT_EQ(fmm::value_to_string(f, precision), value_to_chars_string(f, precision));
+
+            std::complex<double> c(d, -d);
+            EXPECT_EQ(fmm::value_to_string(c, precision), value_to_chars_string(c, precision));
+        }
+    }
+}
@@ -6,6 +6,8 @@
 
 #include "fmm_tests.hpp"
 
+#include <fast_matrix_market/app/variant_triplet.hpp>
+
 #if defined(__clang__)
 // for TYPED_TEST_SUITE
 #pragma clang diagnostic ignored "-Wgnu-zero-variadic-macro-arguments"
@@ -116,3 +118,57 @@ TEST(TripletTest, BoolRaceConditions) {
         EXPECT_EQ(triplet, triplet2);
     }
 }
+
+TEST(TripletTest, Variant) {
+    using fast_matrix_market::triplet_vectors;
+
+    auto read_variant = [](const std::string& mtx, fast_matrix_market::value_precision precision) {
+        std::istringstream iss(mtx);
+        fast_matrix_market::matrix_market_header header;
+        return fast_matrix_market::read_matrix_market_triplet_variant(iss, header, precision);
+    };
+
+    std::string small = "%%MatrixMarket matrix coordinate real general\n3 4 2\n1 4 1.5\n3 2 -2\n";
+    {
+        auto v = read_variant(small, fast_matrix_market::DoublePrecision);
+        ASSERT_TRUE((std::holds_alternative<triplet_vectors<uint16_t, double>>(v)));
+        const auto& t = std::get<triplet_vectors<uint16_t, double>>(v);
+        EXPECT_EQ(t.rows, std::vector<uint16_t>({0, 2}));
+        EXPECT_EQ(t.cols, std::vector<uint16_t>({3, 1}));
+        EXPECT_EQ(t.values, std::vector<double>({1.5, -2}));
+    }
+    {
+        auto v = read_variant(small, fast_matrix_market::SinglePrecision);
+        ASSERT_TRUE((std::holds_alternative<triplet_vectors<uint16_t, float>>(v)));
+        EXPECT_EQ((std::get<triplet_vectors<uint16_t, float>>(v).values), std::vector<float>({1.5f, -2}));
+    }
+
+    std::string max16 = "%%MatrixMarket matrix coordinate pattern general\n65535 1 1\n65535 1\n";
+    {
+        auto v = read_variant(max16, fast_matrix_market::DoublePrecision);
+        ASSERT_TRUE((std::holds_alternative<triplet_vectors<uint16_t, double>>(v)));
+        EXPECT_EQ((std::get<triplet_vectors<uint16_t, double>>(v).rows), std::vector<uint16_t>({65534}));
+    }
+
+    std::string tall = "%%MatrixMarket matrix coordinate integer general\n65536 1 1\n65536 1 7\n";
+    {
+        auto v = read_variant(tall, fast_matrix_market::DoublePrecision);
+        ASSERT_TRUE((std::holds_alternative<triplet_vectors<uint32_t, double>>(v)));
+        EXPECT_EQ((std::get<triplet_vectors<uint32_t, double>>(v).rows), std::vector<uint32_t>({65535}));
+    }
+
+    std::string huge = "%%MatrixMarket matrix coordinate real general\n1 5000000000 1\n1 5000000000 1\n";
+    {
+        auto v = read_variant(huge, fast_matrix_market::DoublePrecision);
+        ASSERT_TRUE((std::holds_alternative<triplet_vectors<int64_t, double>>(v)));
+        EXPECT_EQ((std::get<triplet_vectors<int64_t, double>>(v).cols), std::vector<int64_t>({4999999999}));
+    }
+
+    std::string cplx = "%%MatrixMarket matrix coordinate complex general\n2 2 1\n2 1 1 -1\n";
+    {
+        auto v = read_variant(cplx, fast_matrix_market::DoublePrecision);
+        ASSERT_TRUE((std::holds_alternative<triplet_vectors<uint16_t, std::complex<double>>>(v)));
+        EXPECT_EQ((std::get<triplet_vectors<uint16_t, std::complex<double>>>(v).values),
+                  std::vector<std::complex<double>>({{1, -1}}));
+    }
+}